@@ -0,0 +1,191 @@
+#include "byte_stream.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+#include <cstring>
+
+void ByteWriter::put_u8(const uint8_t value) {
+	buffer.push_back(value);
+}
+
+void ByteWriter::put_u32(const uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		buffer.push_back((value >> (i * 8)) & 0xFF);
+	}
+}
+
+void ByteWriter::put_varint(uint64_t value) {
+	while (value >= 0x80) {
+		buffer.push_back(uint8_t(value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	buffer.push_back(uint8_t(value));
+}
+
+void ByteWriter::put_zigzag(const int64_t value) {
+	put_varint((uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+void ByteWriter::put_float(const float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put_u32(bits);
+}
+
+void ByteWriter::put_double(const double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put_u32(uint32_t(bits));
+	put_u32(uint32_t(bits >> 32));
+}
+
+void ByteWriter::put_bytes(const uint8_t *data, const int64_t size) {
+	uint32_t offset = buffer.size();
+	buffer.resize(offset + size);
+	if (size > 0)
+		memcpy(buffer.ptr() + offset, data, size);
+}
+
+void ByteWriter::put_buffer(const PackedByteArray &data) {
+	put_varint(data.size());
+	put_bytes(data.ptr(), data.size());
+}
+
+void ByteWriter::put_string(const String &value) {
+	put_buffer(value.to_utf8_buffer());
+}
+
+void ByteWriter::put_variant(const Variant &value) {
+	put_buffer(UtilityFunctions::var_to_bytes(value));
+}
+
+int64_t ByteWriter::size() const {
+	return buffer.size();
+}
+
+void ByteWriter::clear() {
+	buffer.clear();
+}
+
+void ByteWriter::erase_front(const int64_t count) {
+	if (count <= 0)
+		return;
+	if (count >= int64_t(buffer.size())) {
+		buffer.clear();
+		return;
+	}
+	memmove(buffer.ptr(), buffer.ptr() + count, buffer.size() - count);
+	buffer.resize(buffer.size() - count);
+}
+
+PackedByteArray ByteWriter::to_packed(const int64_t from) const {
+	PackedByteArray result = PackedByteArray();
+	int64_t length = buffer.size();
+	int64_t start = CLAMP(from, int64_t(0), length);
+	result.resize(length - start);
+	if (length > start)
+		memcpy(result.ptrw(), buffer.ptr() + start, length - start);
+	return result;
+}
+
+ByteReader::ByteReader(const PackedByteArray &data, const int64_t offset) {
+	this->data = data;
+	ptr = this->data.ptr();
+	length = this->data.size();
+	position = offset;
+	error = offset > length;
+}
+
+uint8_t ByteReader::get_u8() {
+	if (position >= length) {
+		error = true;
+		return 0;
+	}
+	return ptr[position++];
+}
+
+uint32_t ByteReader::get_u32() {
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++) {
+		value |= uint32_t(get_u8()) << (i * 8);
+	}
+	return value;
+}
+
+uint64_t ByteReader::get_varint() {
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t byte = get_u8();
+		value |= uint64_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	error = true;
+	return 0;
+}
+
+int64_t ByteReader::get_zigzag() {
+	uint64_t value = get_varint();
+	return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+float ByteReader::get_float() {
+	uint32_t bits = get_u32();
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+double ByteReader::get_double() {
+	uint64_t bits = get_u32();
+	bits |= uint64_t(get_u32()) << 32;
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+PackedByteArray ByteReader::get_buffer(const int64_t size) {
+	PackedByteArray result = PackedByteArray();
+	if (size < 0 || size > length - position) {
+		error = true;
+		return result;
+	}
+	result.resize(size);
+	if (size > 0)
+		memcpy(result.ptrw(), ptr + position, size);
+	position += size;
+	return result;
+}
+
+String ByteReader::get_string() {
+	int64_t size = get_varint();
+	if (error || size < 0 || size > length - position) {
+		error = true;
+		return String();
+	}
+	String value = String::utf8((const char *)(ptr + position), size);
+	position += size;
+	return value;
+}
+
+Variant ByteReader::get_variant() {
+	PackedByteArray bytes = get_buffer(get_varint());
+	if (error)
+		return Variant();
+	return UtilityFunctions::bytes_to_var(bytes);
+}
+
+int64_t ByteReader::get_position() const {
+	return position;
+}
+
+bool ByteReader::is_at_end() const {
+	return position >= length;
+}
+
+bool ByteReader::has_error() const {
+	return error;
+}
+
+void ByteReader::set_error() {
+	error = true;
+}
@@ -0,0 +1,59 @@
+#ifndef BYTE_STREAM_H
+#define BYTE_STREAM_H
+
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/variant/variant.hpp>
+
+using namespace godot;
+
+// Little-endian writer used by the compact save formats. Bytes are collected
+// natively and copied into a PackedByteArray once, at the end.
+class ByteWriter {
+private:
+	LocalVector<uint8_t> buffer;
+
+public:
+	void put_u8(const uint8_t value);
+	void put_u32(const uint32_t value);
+	void put_varint(uint64_t value);
+	void put_zigzag(const int64_t value);
+	void put_float(const float value);
+	void put_double(const double value);
+	void put_bytes(const uint8_t *data, const int64_t size);
+	void put_buffer(const PackedByteArray &data);
+	void put_string(const String &value);
+	void put_variant(const Variant &value);
+	int64_t size() const;
+	void clear();
+	void erase_front(const int64_t count);
+	PackedByteArray to_packed(const int64_t from = 0) const;
+};
+
+// Bounds-checked counterpart of ByteWriter. Reading past the end sets the
+// error flag and returns zeroed values instead of failing on every call.
+class ByteReader {
+private:
+	PackedByteArray data;
+	const uint8_t *ptr = nullptr;
+	int64_t length = 0;
+	int64_t position = 0;
+	bool error = false;
+
+public:
+	ByteReader(const PackedByteArray &data, const int64_t offset = 0);
+	uint8_t get_u8();
+	uint32_t get_u32();
+	uint64_t get_varint();
+	int64_t get_zigzag();
+	float get_float();
+	double get_double();
+	PackedByteArray get_buffer(const int64_t size);
+	String get_string();
+	Variant get_variant();
+	int64_t get_position() const;
+	bool is_at_end() const;
+	bool has_error() const;
+	void set_error();
+};
+
+#endif // BYTE_STREAM_H
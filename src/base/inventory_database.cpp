@@ -1,15 +1,20 @@
 #include "inventory_database.h"
+#include "byte_stream.h"
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/global_constants.hpp>
 #include <godot_cpp/classes/resource_loader.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
 
 #include <godot_cpp/classes/json.hpp>
 #include <godot_cpp/variant/variant.hpp>
 
 void InventoryDatabase::_update_items_cache() {
+	// Product categories come from the item definitions.
+	recipe_indexes_dirty = true;
 	items_cache.clear();
 	for (size_t i = 0; i < items.size(); i++) {
 		Ref<ItemDefinition> item = items[i];
@@ -32,6 +37,262 @@ void InventoryDatabase::_update_items_categories_cache() {
 	}
 }
 
+void InventoryDatabase::_index_recipe(HashMap<String, PackedInt32Array> &index, const String &key, const int recipe_index) {
+	PackedInt32Array *recipe_indexes = index.getptr(key);
+	if (recipe_indexes == nullptr) {
+		PackedInt32Array new_recipe_indexes;
+		new_recipe_indexes.append(recipe_index);
+		index.insert(key, new_recipe_indexes);
+		return;
+	}
+	// A recipe with several products of the same item or category is listed once.
+	if (recipe_indexes->size() > 0 && (*recipe_indexes)[recipe_indexes->size() - 1] == recipe_index)
+		return;
+	recipe_indexes->append(recipe_index);
+}
+
+void InventoryDatabase::_on_recipe_changed() {
+	recipe_indexes_dirty = true;
+}
+
+void InventoryDatabase::_ensure_recipe_indexes() const {
+	// The array from get_recipes() is shared, so it can grow or change
+	// without going through set_recipes.
+	if (!recipe_indexes_dirty && indexed_recipes == recipes)
+		return;
+	recipe_indexes_dirty = false;
+	indexed_recipes = recipes.duplicate();
+	Callable on_recipe_changed = callable_mp(const_cast<InventoryDatabase *>(this), &InventoryDatabase::_on_recipe_changed);
+	recipes_by_station.clear();
+	recipes_by_product.clear();
+	recipes_by_category.clear();
+	for (int i = 0; i < recipes.size(); i++) {
+		Ref<Recipe> recipe = recipes[i];
+		if (recipe == nullptr)
+			continue;
+		if (!recipe->is_connected("changed", on_recipe_changed))
+			recipe->connect("changed", on_recipe_changed);
+		String station_id = "";
+		if (recipe->get_station() != nullptr)
+			station_id = recipe->get_station()->get_id();
+		_index_recipe(recipes_by_station, station_id, i);
+		TypedArray<ItemStack> products = recipe->get_products();
+		for (int product_index = 0; product_index < products.size(); product_index++) {
+			Ref<ItemStack> product = products[product_index];
+			if (product == nullptr)
+				continue;
+			_index_recipe(recipes_by_product, product->get_item_id(), i);
+			Ref<ItemDefinition> definition = get_item(product->get_item_id());
+			if (definition == nullptr)
+				continue;
+			TypedArray<ItemCategory> categories = definition->get_categories();
+			for (int category_index = 0; category_index < categories.size(); category_index++) {
+				Ref<ItemCategory> category = categories[category_index];
+				if (category != nullptr)
+					_index_recipe(recipes_by_category, category->get_id(), i);
+			}
+		}
+	}
+}
+
+// Values whose type matches the definition default are written without a type tag.
+static bool _is_schema_value(const Variant &value, const Variant &default_value) {
+	if (value.get_type() != default_value.get_type())
+		return false;
+	switch (value.get_type()) {
+		case Variant::BOOL:
+		case Variant::INT:
+		case Variant::STRING:
+			return true;
+		case Variant::FLOAT:
+			return double(float(double(value))) == double(value);
+		default:
+			return false;
+	}
+}
+
+static void _put_schema_value(ByteWriter &writer, const Variant &value) {
+	switch (value.get_type()) {
+		case Variant::INT:
+			writer.put_zigzag(value);
+			break;
+		case Variant::FLOAT:
+			writer.put_float(double(value));
+			break;
+		case Variant::STRING:
+			writer.put_string(value);
+			break;
+		default:
+			// Booleans only reach here when they differ from the default.
+			break;
+	}
+}
+
+// Identifies the key order and value types the positional section is written against.
+static uint32_t _get_property_schema_hash(const TypedArray<String> &keys, const Dictionary &defaults, const int schema_size) {
+	uint32_t hash = uint32_t(schema_size);
+	for (int i = 0; i < schema_size; i++) {
+		String key = keys[i];
+		hash = hash * 31 + key.hash();
+		hash = hash * 31 + uint32_t(defaults.get(key, Variant()).get_type());
+	}
+	return hash;
+}
+
+static Variant _get_schema_value(ByteReader &reader, const Variant &default_value) {
+	switch (default_value.get_type()) {
+		case Variant::BOOL:
+			return !bool(default_value);
+		case Variant::INT:
+			return reader.get_zigzag();
+		case Variant::FLOAT:
+			return reader.get_float();
+		case Variant::STRING:
+			return reader.get_string();
+		default:
+			return Variant();
+	}
+}
+
+// Compressed payloads start with this header, followed by the engine-compressed
+// string section and variant stream.
+static const uint8_t COMPRESSED_DATA_MAGIC[3] = { 'I', 'V', 'C' };
+static const uint8_t COMPRESSED_DATA_VERSION = 2;
+static const int COMPRESSED_DATA_MAX_DEPTH = 256;
+// Upper bound for the decompressed size read from the header.
+static const int64_t COMPRESSED_DATA_MAX_SIZE = 256 * 1024 * 1024;
+
+enum CompressedTag {
+	TAG_NIL,
+	TAG_FALSE,
+	TAG_TRUE,
+	TAG_INT,
+	TAG_FLOAT,
+	TAG_STRING,
+	TAG_STRING_REF,
+	TAG_ARRAY,
+	TAG_DICTIONARY,
+	TAG_BYTES,
+	TAG_VARIANT,
+};
+
+// Every string is stored once in the string section at the front of the
+// payload and referenced by index from the stream, so ids and keys cost a byte
+// or two without tying the data to the database contents.
+static void _put_compressed_variant(ByteWriter &writer, const Variant &value, HashMap<String, int> &string_indexes, PackedStringArray &strings) {
+	switch (value.get_type()) {
+		case Variant::NIL:
+			writer.put_u8(TAG_NIL);
+			break;
+		case Variant::BOOL:
+			writer.put_u8(bool(value) ? TAG_TRUE : TAG_FALSE);
+			break;
+		case Variant::INT:
+			writer.put_u8(TAG_INT);
+			writer.put_zigzag(value);
+			break;
+		case Variant::FLOAT:
+			writer.put_u8(TAG_FLOAT);
+			writer.put_double(value);
+			break;
+		case Variant::STRING: {
+			String string = value;
+			const int *string_index = string_indexes.getptr(string);
+			writer.put_u8(TAG_STRING_REF);
+			if (string_index != nullptr) {
+				writer.put_varint(*string_index);
+			} else {
+				writer.put_varint(string_indexes.size());
+				string_indexes.insert(string, string_indexes.size());
+				strings.push_back(string);
+			}
+			break;
+		}
+		case Variant::ARRAY: {
+			Array array = value;
+			writer.put_u8(TAG_ARRAY);
+			writer.put_varint(array.size());
+			for (int64_t i = 0; i < array.size(); i++) {
+				_put_compressed_variant(writer, array[i], string_indexes, strings);
+			}
+			break;
+		}
+		case Variant::DICTIONARY: {
+			Dictionary dictionary = value;
+			Array keys = dictionary.keys();
+			writer.put_u8(TAG_DICTIONARY);
+			writer.put_varint(keys.size());
+			for (int64_t i = 0; i < keys.size(); i++) {
+				_put_compressed_variant(writer, keys[i], string_indexes, strings);
+				_put_compressed_variant(writer, dictionary[keys[i]], string_indexes, strings);
+			}
+			break;
+		}
+		case Variant::PACKED_BYTE_ARRAY:
+			writer.put_u8(TAG_BYTES);
+			writer.put_buffer(value);
+			break;
+		default:
+			writer.put_u8(TAG_VARIANT);
+			writer.put_variant(value);
+			break;
+	}
+}
+
+static Variant _get_compressed_variant(ByteReader &reader, PackedStringArray &strings, const int depth) {
+	if (depth > COMPRESSED_DATA_MAX_DEPTH || reader.has_error())
+		return Variant();
+	switch (reader.get_u8()) {
+		case TAG_NIL:
+			return Variant();
+		case TAG_FALSE:
+			return false;
+		case TAG_TRUE:
+			return true;
+		case TAG_INT:
+			return reader.get_zigzag();
+		case TAG_FLOAT:
+			return reader.get_double();
+		case TAG_STRING: {
+			String string = reader.get_string();
+			strings.push_back(string);
+			return string;
+		}
+		case TAG_STRING_REF: {
+			uint64_t index = reader.get_varint();
+			if (index >= uint64_t(strings.size())) {
+				reader.set_error();
+				ERR_FAIL_V_MSG(Variant(), "Compressed data references an unknown string.");
+			}
+			return strings[index];
+		}
+		case TAG_ARRAY: {
+			Array array = Array();
+			uint64_t size = reader.get_varint();
+			for (uint64_t i = 0; i < size && !reader.has_error(); i++) {
+				array.append(_get_compressed_variant(reader, strings, depth + 1));
+			}
+			return array;
+		}
+		case TAG_DICTIONARY: {
+			Dictionary dictionary = Dictionary();
+			uint64_t size = reader.get_varint();
+			for (uint64_t i = 0; i < size && !reader.has_error(); i++) {
+				Variant key = _get_compressed_variant(reader, strings, depth + 1);
+				dictionary[key] = _get_compressed_variant(reader, strings, depth + 1);
+			}
+			return dictionary;
+		}
+		case TAG_BYTES:
+			return reader.get_buffer(reader.get_varint());
+		case TAG_VARIANT:
+			return reader.get_variant();
+		default:
+			reader.set_error();
+			ERR_FAIL_V_MSG(Variant(), "Compressed data contains an unknown tag.");
+	}
+}
+
 void InventoryDatabase::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_items", "items"), &InventoryDatabase::set_items);
 	ClassDB::bind_method(D_METHOD("get_items"), &InventoryDatabase::get_items);
@@ -41,6 +302,8 @@ void InventoryDatabase::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_stations_type"), &InventoryDatabase::get_stations_type);
 	ClassDB::bind_method(D_METHOD("set_item_categories", "item_categories"), &InventoryDatabase::set_item_categories);
 	ClassDB::bind_method(D_METHOD("get_item_categories"), &InventoryDatabase::get_item_categories);
+	ClassDB::bind_method(D_METHOD("set_compact_stack_properties", "compact_stack_properties"), &InventoryDatabase::set_compact_stack_properties);
+	ClassDB::bind_method(D_METHOD("get_compact_stack_properties"), &InventoryDatabase::get_compact_stack_properties);
 
 	ClassDB::bind_method(D_METHOD("add_new_item", "item"), &InventoryDatabase::add_new_item);
 	ClassDB::bind_method(D_METHOD("remove_item", "item"), &InventoryDatabase::remove_item);
@@ -63,6 +326,10 @@ void InventoryDatabase::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("deserialize_station_type", "station_type", "data"), &InventoryDatabase::deserialize_station_type);
 
 	ClassDB::bind_method(D_METHOD("get_category_from_id", "id"), &InventoryDatabase::get_category_from_id);
+	ClassDB::bind_method(D_METHOD("update_recipe_indexes"), &InventoryDatabase::update_recipe_indexes);
+	ClassDB::bind_method(D_METHOD("get_recipes_for_station", "station_id"), &InventoryDatabase::get_recipes_for_station);
+	ClassDB::bind_method(D_METHOD("get_recipes_producing", "item_id"), &InventoryDatabase::get_recipes_producing);
+	ClassDB::bind_method(D_METHOD("get_recipes_producing_category", "category_id"), &InventoryDatabase::get_recipes_producing_category);
 
 	ClassDB::bind_method(D_METHOD("add_item"), &InventoryDatabase::add_item);
 	ClassDB::bind_method(D_METHOD("add_item_category"), &InventoryDatabase::add_item_category);
@@ -76,11 +343,19 @@ void InventoryDatabase::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("export_json_file", "path"), &InventoryDatabase::export_json_file);
 
 	ClassDB::bind_method(D_METHOD("create_dynamic_properties", "item_id"), &InventoryDatabase::create_dynamic_properties);
+	ClassDB::bind_method(D_METHOD("serialize_stack_properties", "item_id", "properties"), &InventoryDatabase::serialize_stack_properties);
+	ClassDB::bind_method(D_METHOD("deserialize_stack_properties", "item_id", "data"), &InventoryDatabase::deserialize_stack_properties);
+	ClassDB::bind_method(D_METHOD("compress_data", "data", "compression_mode"), &InventoryDatabase::compress_data, DEFVAL(FileAccess::COMPRESSION_ZSTD));
+	ClassDB::bind_method(D_METHOD("decompress_data", "data"), &InventoryDatabase::decompress_data);
+	ClassDB::bind_method(D_METHOD("compress_data_async", "data", "callback", "compression_mode"), &InventoryDatabase::compress_data_async, DEFVAL(FileAccess::COMPRESSION_ZSTD));
+	ClassDB::bind_method(D_METHOD("decompress_data_async", "data", "callback"), &InventoryDatabase::decompress_data_async);
+	ClassDB::bind_method(D_METHOD("_finish_async_task", "task_key", "callback", "result"), &InventoryDatabase::_finish_async_task);
 
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "items", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "ItemDefinition")), "set_items", "get_items");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "recipes", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "Recipe")), "set_recipes", "get_recipes");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "stations_type", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "CraftStationType")), "set_stations_type", "get_stations_type");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "item_categories", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "ItemCategory")), "set_item_categories", "get_item_categories");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "compact_stack_properties"), "set_compact_stack_properties", "get_compact_stack_properties");
 }
 
 InventoryDatabase::InventoryDatabase() {
@@ -100,6 +375,7 @@ TypedArray<ItemDefinition> InventoryDatabase::get_items() const {
 
 void InventoryDatabase::set_recipes(const TypedArray<Recipe> &new_recipes) {
 	recipes = new_recipes;
+	recipe_indexes_dirty = true;
 }
 
 TypedArray<Recipe> InventoryDatabase::get_recipes() const {
@@ -139,6 +415,14 @@ Dictionary InventoryDatabase::get_categories_code_cache() const {
 	return categories_code_cache;
 }
 
+void InventoryDatabase::set_compact_stack_properties(const bool &new_compact_stack_properties) {
+	compact_stack_properties = new_compact_stack_properties;
+}
+
+bool InventoryDatabase::get_compact_stack_properties() const {
+	return compact_stack_properties;
+}
+
 void InventoryDatabase::add_new_item(const Ref<ItemDefinition> item) {
 	items.append(item);
 	_update_items_cache();
@@ -381,11 +665,14 @@ void InventoryDatabase::deserialize_station_type(Ref<CraftStationType> craft_sta
 	}
 }
 
-Array InventoryDatabase::serialize_item_stacks(const TypedArray<ItemStack> item_stacks) const {
+Array InventoryDatabase::serialize_item_stacks(const TypedArray<ItemStack> item_stacks, const bool compact_properties) const {
 	Array slots_data = Array();
 	for (size_t item_stack_index = 0; item_stack_index < item_stacks.size(); item_stack_index++) {
 		Ref<ItemStack> item_stack = item_stacks[item_stack_index];
 		Array data = item_stack->serialize();
+		if (compact_properties && data.size() > 2) {
+			data[2] = serialize_stack_properties(item_stack->get_item_id(), item_stack->get_properties());
+		}
 		slots_data.append(data);
 	}
 	return slots_data;
@@ -393,13 +680,18 @@ Array InventoryDatabase::serialize_item_stacks(const TypedArray<ItemStack> item_
 
 void InventoryDatabase::deserialize_item_stacks(TypedArray<ItemStack> item_stacks, const Array data) const {
 	for (size_t item_stack_index = 0; item_stack_index < data.size(); item_stack_index++) {
+		Array item_stack_data = data[item_stack_index];
+		if (item_stack_data.size() > 2 && item_stack_data[2].get_type() == Variant::PACKED_BYTE_ARRAY) {
+			item_stack_data = item_stack_data.duplicate();
+			item_stack_data[2] = deserialize_stack_properties(item_stack_data[0], item_stack_data[2]);
+		}
 		if (item_stack_index >= item_stacks.size()) {
 			Ref<ItemStack> item_stack = memnew(ItemStack());
-			item_stack->deserialize(data[item_stack_index]);
+			item_stack->deserialize(item_stack_data);
 			item_stacks.append(item_stack);
 		} else {
 			Ref<ItemStack> item_stack = item_stacks[item_stack_index];
-			item_stack->deserialize(data[item_stack_index]);
+			item_stack->deserialize(item_stack_data);
 		}
 	}
 	int size = item_stacks.size();
@@ -408,6 +700,219 @@ void InventoryDatabase::deserialize_item_stacks(TypedArray<ItemStack> item_stack
 	}
 }
 
+PackedByteArray InventoryDatabase::serialize_stack_properties(const String &item_id, const Dictionary &properties) const {
+	Dictionary defaults = Dictionary();
+	TypedArray<String> keys = TypedArray<String>();
+	Ref<ItemDefinition> definition = get_item(item_id);
+	if (definition != nullptr) {
+		defaults = definition->get_properties();
+		keys = definition->get_dynamic_properties();
+	}
+	int schema_size = MIN(keys.size(), 64);
+
+	// Each dynamic property of the definition takes one bit of the masks, in the
+	// order the definition declares them.
+	uint64_t present_mask = 0;
+	uint64_t foreign_mask = 0;
+	uint64_t absent_mask = 0;
+	for (int i = 0; i < schema_size; i++) {
+		uint64_t bit = uint64_t(1) << i;
+		String key = keys[i];
+		if (!properties.has(key)) {
+			absent_mask |= bit;
+			continue;
+		}
+		Variant value = properties[key];
+		Variant default_value = defaults.get(key, Variant());
+		if (value.get_type() == default_value.get_type() && value == default_value)
+			continue;
+		present_mask |= bit;
+		if (!_is_schema_value(value, default_value))
+			foreign_mask |= bit;
+	}
+
+	ByteWriter schema_writer;
+	schema_writer.put_varint(present_mask);
+	schema_writer.put_varint(foreign_mask);
+	schema_writer.put_varint(absent_mask);
+	for (int i = 0; i < schema_size; i++) {
+		uint64_t bit = uint64_t(1) << i;
+		if ((present_mask & bit) == 0)
+			continue;
+		Variant value = properties[keys[i]];
+		if ((foreign_mask & bit) != 0) {
+			schema_writer.put_variant(value);
+		} else {
+			_put_schema_value(schema_writer, value);
+		}
+	}
+
+	// The schema hash lets a reader with an edited definition tell that the
+	// positional section no longer lines up; the section is length-prefixed so
+	// it can then be skipped.
+	ByteWriter writer;
+	writer.put_u32(_get_property_schema_hash(keys, defaults, schema_size));
+	writer.put_buffer(schema_writer.to_packed());
+
+	Array extra_keys = Array();
+	Array property_keys = properties.keys();
+	for (size_t i = 0; i < property_keys.size(); i++) {
+		int64_t key_index = keys.find(property_keys[i]);
+		if (key_index == -1 || key_index >= schema_size)
+			extra_keys.append(property_keys[i]);
+	}
+	writer.put_varint(extra_keys.size());
+	for (size_t i = 0; i < extra_keys.size(); i++) {
+		writer.put_variant(extra_keys[i]);
+		writer.put_variant(properties[extra_keys[i]]);
+	}
+	return writer.to_packed();
+}
+
+Dictionary InventoryDatabase::deserialize_stack_properties(const String &item_id, const PackedByteArray &data) const {
+	Dictionary properties = Dictionary();
+	Dictionary defaults = Dictionary();
+	TypedArray<String> keys = TypedArray<String>();
+	Ref<ItemDefinition> definition = get_item(item_id);
+	if (definition != nullptr) {
+		defaults = definition->get_properties();
+		keys = definition->get_dynamic_properties();
+	}
+	int schema_size = MIN(keys.size(), 64);
+
+	ByteReader reader = ByteReader(data);
+	uint32_t schema_hash = reader.get_u32();
+	PackedByteArray schema_data = reader.get_buffer(reader.get_varint());
+	ERR_FAIL_COND_V_MSG(reader.has_error(), Dictionary(), "Data to deserialize stack properties is invalid.");
+	if (schema_hash == _get_property_schema_hash(keys, defaults, schema_size)) {
+		ByteReader schema_reader = ByteReader(schema_data);
+		uint64_t present_mask = schema_reader.get_varint();
+		uint64_t foreign_mask = schema_reader.get_varint();
+		uint64_t absent_mask = schema_reader.get_varint();
+		for (int i = 0; i < schema_size; i++) {
+			uint64_t bit = uint64_t(1) << i;
+			if ((absent_mask & bit) != 0)
+				continue;
+			String key = keys[i];
+			Variant default_value = defaults.get(key, Variant());
+			if ((present_mask & bit) == 0) {
+				properties[key] = default_value;
+			} else if ((foreign_mask & bit) != 0) {
+				properties[key] = schema_reader.get_variant();
+			} else {
+				properties[key] = _get_schema_value(schema_reader, default_value);
+			}
+		}
+		ERR_FAIL_COND_V_MSG(schema_reader.has_error(), Dictionary(), "Data to deserialize stack properties is invalid.");
+	} else {
+		// Written for another version of the definition: the positional values
+		// cannot be matched to keys, so the dynamic properties fall back to the
+		// definition defaults and only the keyed entries below are kept.
+		ERR_PRINT(vformat("Stack properties of '%s' were written for a different property schema; dynamic properties are reset to their defaults.", item_id));
+		for (int i = 0; i < schema_size; i++) {
+			String key = keys[i];
+			properties[key] = defaults.get(key, Variant());
+		}
+	}
+
+	uint64_t extra_count = reader.get_varint();
+	for (uint64_t i = 0; i < extra_count && !reader.has_error(); i++) {
+		Variant key = reader.get_variant();
+		properties[key] = reader.get_variant();
+	}
+	ERR_FAIL_COND_V_MSG(reader.has_error(), Dictionary(), "Data to deserialize stack properties is invalid.");
+	return properties;
+}
+
+PackedByteArray InventoryDatabase::compress_variant(const Variant &data, const int compression_mode) {
+	HashMap<String, int> string_indexes;
+	PackedStringArray strings;
+	ByteWriter body;
+	_put_compressed_variant(body, data, string_indexes, strings);
+
+	ByteWriter raw_writer;
+	raw_writer.put_varint(strings.size());
+	for (int64_t i = 0; i < strings.size(); i++) {
+		raw_writer.put_string(strings[i]);
+	}
+	PackedByteArray raw = raw_writer.to_packed();
+	raw.append_array(body.to_packed());
+
+	ByteWriter header;
+	header.put_bytes(COMPRESSED_DATA_MAGIC, 3);
+	header.put_u8(COMPRESSED_DATA_VERSION);
+	header.put_u8(compression_mode);
+	header.put_varint(raw.size());
+	PackedByteArray result = header.to_packed();
+	result.append_array(raw.compress(compression_mode));
+	return result;
+}
+
+Variant InventoryDatabase::decompress_variant(const PackedByteArray &data) {
+	ByteReader header = ByteReader(data);
+	bool valid_magic = header.get_u8() == COMPRESSED_DATA_MAGIC[0] && header.get_u8() == COMPRESSED_DATA_MAGIC[1] && header.get_u8() == COMPRESSED_DATA_MAGIC[2];
+	ERR_FAIL_COND_V_MSG(!valid_magic || header.get_u8() != COMPRESSED_DATA_VERSION, Variant(), "Data to decompress is invalid: Unknown format.");
+	int compression_mode = header.get_u8();
+	uint64_t raw_size = header.get_varint();
+	ERR_FAIL_COND_V_MSG(header.has_error(), Variant(), "Data to decompress is invalid: Truncated header.");
+	ERR_FAIL_COND_V_MSG(raw_size > uint64_t(COMPRESSED_DATA_MAX_SIZE), Variant(), "Data to decompress is invalid: Size is too large.");
+
+	PackedByteArray raw = data.slice(header.get_position()).decompress(raw_size, compression_mode);
+	ERR_FAIL_COND_V_MSG(uint64_t(raw.size()) != raw_size, Variant(), "Data to decompress is invalid: Decompression failed.");
+	ByteReader reader = ByteReader(raw);
+	uint64_t string_count = reader.get_varint();
+	// Each string takes at least its length byte.
+	ERR_FAIL_COND_V_MSG(string_count > raw_size, Variant(), "Data to decompress is invalid: Bad string section.");
+	PackedStringArray strings;
+	for (uint64_t i = 0; i < string_count && !reader.has_error(); i++) {
+		strings.push_back(reader.get_string());
+	}
+	Variant result = _get_compressed_variant(reader, strings, 0);
+	ERR_FAIL_COND_V_MSG(reader.has_error(), Variant(), "Data to decompress is invalid: Truncated data.");
+	return result;
+}
+
+void InventoryDatabase::_compress_task(const Ref<InventoryDatabase> &database, const uint64_t task_key, const Variant &data, const int compression_mode, const Callable &callback) {
+	database->call_deferred("_finish_async_task", task_key, callback, compress_variant(data, compression_mode));
+}
+
+void InventoryDatabase::_decompress_task(const Ref<InventoryDatabase> &database, const uint64_t task_key, const PackedByteArray &data, const Callable &callback) {
+	database->call_deferred("_finish_async_task", task_key, callback, decompress_variant(data));
+}
+
+void InventoryDatabase::_finish_async_task(const uint64_t task_key, const Callable &callback, const Variant &result) {
+	// The worker posts this right before returning, so the wait is short, but
+	// every pool task has to be waited on to be released.
+	const int64_t *task_id = _async_tasks.getptr(task_key);
+	if (task_id != nullptr) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(*task_id);
+		_async_tasks.erase(task_key);
+	}
+	callback.call(result);
+}
+
+PackedByteArray InventoryDatabase::compress_data(const Variant &data, const int compression_mode) const {
+	return compress_variant(data, compression_mode);
+}
+
+Variant InventoryDatabase::decompress_data(const PackedByteArray &data) const {
+	return decompress_variant(data);
+}
+
+void InventoryDatabase::compress_data_async(const Variant &data, const Callable &callback, const int compression_mode) const {
+	// The worker gets a private copy of the data, so it never reads values the
+	// main thread may be editing.
+	uint64_t task_key = _next_async_task++;
+	Callable task = callable_mp_static(&InventoryDatabase::_compress_task).bind(Ref<InventoryDatabase>(const_cast<InventoryDatabase *>(this)), task_key, data.duplicate(true), compression_mode, callback);
+	_async_tasks.insert(task_key, WorkerThreadPool::get_singleton()->add_task(task));
+}
+
+void InventoryDatabase::decompress_data_async(const PackedByteArray &data, const Callable &callback) const {
+	uint64_t task_key = _next_async_task++;
+	Callable task = callable_mp_static(&InventoryDatabase::_decompress_task).bind(Ref<InventoryDatabase>(const_cast<InventoryDatabase *>(this)), task_key, data, callback);
+	_async_tasks.insert(task_key, WorkerThreadPool::get_singleton()->add_task(task));
+}
+
 void InventoryDatabase::add_item() {
 	Ref<ItemDefinition> definition = memnew(ItemDefinition());
 	items.append(definition);
@@ -421,6 +926,7 @@ void InventoryDatabase::add_item_category() {
 void InventoryDatabase::add_recipe() {
 	Ref<Recipe> recipe = memnew(Recipe());
 	recipes.append(recipe);
+	recipe_indexes_dirty = true;
 }
 
 void InventoryDatabase::add_craft_station_type() {
@@ -446,6 +952,29 @@ Ref<CraftStationType> InventoryDatabase::get_craft_station_from_id(String id) co
 	return nullptr;
 }
 
+void InventoryDatabase::update_recipe_indexes() {
+	recipe_indexes_dirty = true;
+	_ensure_recipe_indexes();
+}
+
+PackedInt32Array InventoryDatabase::get_recipes_for_station(const String &station_id) const {
+	_ensure_recipe_indexes();
+	const PackedInt32Array *recipe_indexes = recipes_by_station.getptr(station_id);
+	return recipe_indexes == nullptr ? PackedInt32Array() : *recipe_indexes;
+}
+
+PackedInt32Array InventoryDatabase::get_recipes_producing(const String &item_id) const {
+	_ensure_recipe_indexes();
+	const PackedInt32Array *recipe_indexes = recipes_by_product.getptr(item_id);
+	return recipe_indexes == nullptr ? PackedInt32Array() : *recipe_indexes;
+}
+
+PackedInt32Array InventoryDatabase::get_recipes_producing_category(const String &category_id) const {
+	_ensure_recipe_indexes();
+	const PackedInt32Array *recipe_indexes = recipes_by_category.getptr(category_id);
+	return recipe_indexes == nullptr ? PackedInt32Array() : *recipe_indexes;
+}
+
 Dictionary InventoryDatabase::serialize() const {
 	Dictionary data = Dictionary();
 	Array item_categories_data = serialize_item_categories();
@@ -557,6 +1086,7 @@ void InventoryDatabase::deserialize_recipes(Array datas) {
 		deserialize_recipe(recipe, datas[i]);
 		recipes.append(recipe);
 	}
+	recipe_indexes_dirty = true;
 }
 
 void InventoryDatabase::clear_current_data() {
@@ -564,6 +1094,7 @@ void InventoryDatabase::clear_current_data() {
 	item_categories.clear();
 	stations_type.clear();
 	recipes.clear();
+	recipe_indexes_dirty = true;
 }
 
 String InventoryDatabase::export_to_invdata() const {
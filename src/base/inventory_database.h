@@ -1,8 +1,10 @@
 #ifndef INVENTORY_DATABASE_CLASS_H
 #define INVENTORY_DATABASE_CLASS_H
 
+#include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/resource.hpp>
 #include <godot_cpp/classes/texture2d.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
 
 #include "craft_station_type.h"
 #include "item_category.h"
@@ -21,9 +23,23 @@ private:
 	TypedArray<ItemCategory> item_categories;
 	Dictionary items_cache;
 	Dictionary categories_code_cache;
+	bool compact_stack_properties = false;
+	mutable HashMap<String, PackedInt32Array> recipes_by_station;
+	mutable HashMap<String, PackedInt32Array> recipes_by_product;
+	mutable HashMap<String, PackedInt32Array> recipes_by_category;
+	mutable bool recipe_indexes_dirty = true;
+	mutable TypedArray<Recipe> indexed_recipes;
+	void _on_recipe_changed();
 
 	void _update_items_cache();
+	void _ensure_recipe_indexes() const;
+	static void _index_recipe(HashMap<String, PackedInt32Array> &index, const String &key, const int recipe_index);
 	void _update_items_categories_cache();
+	mutable HashMap<uint64_t, int64_t> _async_tasks;
+	mutable uint64_t _next_async_task = 0;
+	static void _compress_task(const Ref<InventoryDatabase> &database, const uint64_t task_key, const Variant &data, const int compression_mode, const Callable &callback);
+	static void _decompress_task(const Ref<InventoryDatabase> &database, const uint64_t task_key, const PackedByteArray &data, const Callable &callback);
+	void _finish_async_task(const uint64_t task_key, const Callable &callback, const Variant &result);
 
 protected:
 	static void _bind_methods();
@@ -43,6 +59,8 @@ public:
 	Dictionary get_items_cache() const;
 	void set_categories_code_cache(const Dictionary &new_categories_code_cache);
 	Dictionary get_categories_code_cache() const;
+	void set_compact_stack_properties(const bool &new_compact_stack_properties);
+	bool get_compact_stack_properties() const;
 
 	void add_new_item(const Ref<ItemDefinition> item);
 	void remove_item(const Ref<ItemDefinition> item);
@@ -64,8 +82,16 @@ public:
 	void deserialize_recipe(Ref<Recipe> recipe, const Dictionary data) const;
 	Dictionary serialize_station_type(const Ref<CraftStationType> craft_station_type) const;
 	void deserialize_station_type(Ref<CraftStationType> craft_station_type, const Dictionary data) const;
-	Array serialize_item_stacks(const TypedArray<ItemStack> stacks) const;
+	Array serialize_item_stacks(const TypedArray<ItemStack> stacks, const bool compact_properties = false) const;
 	void deserialize_item_stacks(TypedArray<ItemStack> stacks, const Array data) const;
+	PackedByteArray serialize_stack_properties(const String &item_id, const Dictionary &properties) const;
+	Dictionary deserialize_stack_properties(const String &item_id, const PackedByteArray &data) const;
+	static PackedByteArray compress_variant(const Variant &data, const int compression_mode);
+	static Variant decompress_variant(const PackedByteArray &data);
+	PackedByteArray compress_data(const Variant &data, const int compression_mode = FileAccess::COMPRESSION_ZSTD) const;
+	Variant decompress_data(const PackedByteArray &data) const;
+	void compress_data_async(const Variant &data, const Callable &callback, const int compression_mode = FileAccess::COMPRESSION_ZSTD) const;
+	void decompress_data_async(const PackedByteArray &data, const Callable &callback) const;
 
 	void add_item();
 	void add_item_category();
@@ -74,6 +100,10 @@ public:
 
 	Ref<ItemCategory> get_category_from_id(String id) const;
 	Ref<CraftStationType> get_craft_station_from_id(String id) const;
+	void update_recipe_indexes();
+	PackedInt32Array get_recipes_for_station(const String &station_id) const;
+	PackedInt32Array get_recipes_producing(const String &item_id) const;
+	PackedInt32Array get_recipes_producing_category(const String &category_id) const;
 
 	Dictionary serialize() const;
 	void deserialize(const Dictionary data);
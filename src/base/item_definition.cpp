@@ -30,6 +30,10 @@ void ItemDefinition::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_weight"), &ItemDefinition::get_weight);
 	ClassDB::bind_method(D_METHOD("set_size", "size"), &ItemDefinition::set_size);
 	ClassDB::bind_method(D_METHOD("get_size"), &ItemDefinition::get_size);
+	ClassDB::bind_method(D_METHOD("set_shape", "shape"), &ItemDefinition::set_shape);
+	ClassDB::bind_method(D_METHOD("get_shape"), &ItemDefinition::get_shape);
+	ClassDB::bind_method(D_METHOD("has_shape"), &ItemDefinition::has_shape);
+	ClassDB::bind_method(D_METHOD("is_shape_cell", "cell", "is_rotated"), &ItemDefinition::is_shape_cell, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("set_properties", "properties"), &ItemDefinition::set_properties);
 	ClassDB::bind_method(D_METHOD("get_properties"), &ItemDefinition::get_properties);
 	ClassDB::bind_method(D_METHOD("set_dynamic_properties", "dynamic_properties"), &ItemDefinition::set_dynamic_properties);
@@ -45,6 +49,7 @@ void ItemDefinition::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "icon", PROPERTY_HINT_RESOURCE_TYPE, "Texture2D"), "set_icon", "get_icon");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "weight"), "set_weight", "get_weight");
 	ADD_PROPERTY(PropertyInfo(Variant::VECTOR2I, "size"), "set_size", "get_size");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "shape"), "set_shape", "get_shape");
 	ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "properties"), "set_properties", "get_properties");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "dynamic_properties", PROPERTY_HINT_ARRAY_TYPE, "String"), "set_dynamic_properties", "get_dynamic_properties");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "categories", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "ItemCategory")), "set_categories", "get_categories");
@@ -116,12 +121,79 @@ void ItemDefinition::set_size(const Vector2i &new_size) {
 		size = Vector2i(1, size.y);
 	if(size.y <= 0)
 		size = Vector2i(size.x, 1);
+	_update_shape_rows();
 }
 
 Vector2i ItemDefinition::get_size() const {
 	return size;
 }
 
+void ItemDefinition::set_shape(const PackedByteArray &new_shape) {
+	shape = new_shape;
+	_update_shape_rows();
+}
+
+PackedByteArray ItemDefinition::get_shape() const {
+	return shape;
+}
+
+bool ItemDefinition::has_shape() const {
+	return !shape_rows.is_empty();
+}
+
+bool ItemDefinition::is_shape_cell(const Vector2i &cell, const bool is_rotated) const {
+	Vector2i cell_size = is_rotated ? get_rotated_size() : size;
+	if (cell.x < 0 || cell.y < 0 || cell.x >= cell_size.x || cell.y >= cell_size.y)
+		return false;
+	const uint64_t *rows = get_shape_rows(is_rotated);
+	if (rows == nullptr)
+		return true;
+	return (rows[cell.y] >> cell.x) & 1;
+}
+
+const uint64_t *ItemDefinition::get_shape_rows(const bool is_rotated) const {
+	// nullptr means the item fills its whole rect.
+	if (shape_rows.is_empty())
+		return nullptr;
+	return is_rotated ? rotated_shape_rows.ptr() : shape_rows.ptr();
+}
+
+void ItemDefinition::_update_shape_rows() {
+	// The shape is one byte per cell of 'size', row by row. Both orientations
+	// are kept as one bit row per grid row so the grid can test them a word
+	// at a time.
+	shape_rows.clear();
+	rotated_shape_rows.clear();
+	if (shape.is_empty())
+		return;
+	ERR_FAIL_COND_MSG(shape.size() != size.x * size.y, "The 'shape' must have one byte per cell of 'size'.");
+	ERR_FAIL_COND_MSG(size.x > 64 || size.y > 64, "Shaped items can't be larger than 64 cells on a side.");
+	bool is_full = true;
+	shape_rows.resize(size.y);
+	for (int y = 0; y < size.y; y++) {
+		shape_rows[y] = 0;
+		for (int x = 0; x < size.x; x++) {
+			if (shape[y * size.x + x] != 0)
+				shape_rows[y] |= uint64_t(1) << x;
+			else
+				is_full = false;
+		}
+	}
+	if (is_full) {
+		shape_rows.clear();
+		return;
+	}
+	// Rotated a quarter turn clockwise, matching the swapped size.
+	rotated_shape_rows.resize(size.x);
+	for (int y = 0; y < size.x; y++) {
+		rotated_shape_rows[y] = 0;
+		for (int x = 0; x < size.y; x++) {
+			if ((shape_rows[size.y - 1 - x] >> y) & 1)
+				rotated_shape_rows[y] |= uint64_t(1) << x;
+		}
+	}
+}
+
 void ItemDefinition::set_properties(const Dictionary &new_properties) {
 	properties = new_properties;
 	_check_invalid_dynamic_properties();
@@ -3,6 +3,7 @@
 
 #include <godot_cpp/classes/resource.hpp>
 #include <godot_cpp/classes/texture2d.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
 
 #include "item_category.h"
 
@@ -19,10 +20,14 @@ private:
 	Ref<Texture2D> icon;
 	float weight = 0.0;
 	Vector2i size = Vector2i(1, 1);
+	PackedByteArray shape;
+	LocalVector<uint64_t> shape_rows;
+	LocalVector<uint64_t> rotated_shape_rows;
 	Dictionary properties;
 	TypedArray<String> dynamic_properties;
 	TypedArray<ItemCategory> categories;
 	void _check_invalid_dynamic_properties();
+	void _update_shape_rows();
 
 protected:
 	static void _bind_methods();
@@ -44,6 +49,11 @@ public:
 	float get_weight() const;
 	void set_size(const Vector2i &new_size);
 	Vector2i get_size() const;
+	void set_shape(const PackedByteArray &new_shape);
+	PackedByteArray get_shape() const;
+	bool has_shape() const;
+	bool is_shape_cell(const Vector2i &cell, const bool is_rotated = false) const;
+	const uint64_t *get_shape_rows(const bool is_rotated) const;
 	void set_properties(const Dictionary &new_properties);
 	Dictionary get_properties() const;
 	void set_dynamic_properties(const TypedArray<String> &new_dynamic_properties);
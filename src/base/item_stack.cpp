@@ -53,6 +53,14 @@ Dictionary ItemStack::get_properties() const {
 	return properties;
 }
 
+// Sets the whole content without emitting "updated", for bulk restores that
+// notify once at the inventory level instead.
+void ItemStack::restore(const String &new_item_id, const int new_amount, const Dictionary &new_properties) {
+	item_id = new_item_id;
+	amount = new_amount;
+	properties = new_properties;
+}
+
 Array ItemStack::serialize() const {
 	Array data = Array();
 	data.append(item_id);
@@ -25,6 +25,7 @@ public:
 	int get_amount() const;
 	void set_properties(const Dictionary &new_properties);
 	Dictionary get_properties() const;
+	void restore(const String &new_item_id, const int new_amount, const Dictionary &new_properties);
 	Array serialize() const;
 	void deserialize(Array data);
 	bool contains(const String &item_id, const int amount = 1) const;
@@ -27,6 +27,7 @@ Recipe::~Recipe() {
 
 void Recipe::set_products(const TypedArray<ItemStack> &new_products) {
 	products = new_products;
+	emit_changed();
 }
 
 TypedArray<ItemStack> Recipe::get_products() const {
@@ -35,6 +36,7 @@ TypedArray<ItemStack> Recipe::get_products() const {
 
 void Recipe::set_time_to_craft(const float &new_time_to_craft) {
 	time_to_craft = new_time_to_craft;
+	emit_changed();
 }
 
 float Recipe::get_time_to_craft() const {
@@ -43,6 +45,7 @@ float Recipe::get_time_to_craft() const {
 
 void Recipe::set_station(const Ref<CraftStationType> &new_station) {
 	station = new_station;
+	emit_changed();
 }
 
 Ref<CraftStationType> Recipe::get_station() const {
@@ -51,6 +54,7 @@ Ref<CraftStationType> Recipe::get_station() const {
 
 void Recipe::set_ingredients(const TypedArray<ItemStack> &new_ingredients) {
 	ingredients = new_ingredients;
+	emit_changed();
 }
 
 TypedArray<ItemStack> Recipe::get_ingredients() const {
@@ -59,6 +63,7 @@ TypedArray<ItemStack> Recipe::get_ingredients() const {
 
 void Recipe::set_required_items(const TypedArray<ItemStack> &new_required_items) {
 	required_items = new_required_items;
+	emit_changed();
 }
 
 TypedArray<ItemStack> Recipe::get_required_items() const {
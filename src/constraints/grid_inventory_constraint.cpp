@@ -1,6 +1,22 @@
 #include "grid_inventory_constraint.h"
 
 void GridInventoryConstraint::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_allowed_cells", "allowed_cells"), &GridInventoryConstraint::set_allowed_cells);
+	ClassDB::bind_method(D_METHOD("get_allowed_cells"), &GridInventoryConstraint::get_allowed_cells);
+	ClassDB::bind_method(D_METHOD("set_allowed_cells_size", "allowed_cells_size"), &GridInventoryConstraint::set_allowed_cells_size);
+	ClassDB::bind_method(D_METHOD("get_allowed_cells_size"), &GridInventoryConstraint::get_allowed_cells_size);
+	ClassDB::bind_method(D_METHOD("set_categories", "categories"), &GridInventoryConstraint::set_categories);
+	ClassDB::bind_method(D_METHOD("get_categories"), &GridInventoryConstraint::get_categories);
+	ClassDB::bind_method(D_METHOD("set_item_ids", "item_ids"), &GridInventoryConstraint::set_item_ids);
+	ClassDB::bind_method(D_METHOD("get_item_ids"), &GridInventoryConstraint::get_item_ids);
+	ClassDB::bind_method(D_METHOD("set_call_script_check", "call_script_check"), &GridInventoryConstraint::set_call_script_check);
+	ClassDB::bind_method(D_METHOD("get_call_script_check"), &GridInventoryConstraint::get_call_script_check);
+	ClassDB::bind_method(D_METHOD("is_cell_allowed", "cell"), &GridInventoryConstraint::is_cell_allowed);
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "allowed_cells"), "set_allowed_cells", "get_allowed_cells");
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR2I, "allowed_cells_size"), "set_allowed_cells_size", "get_allowed_cells_size");
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "categories", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "ItemCategory")), "set_categories", "get_categories");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "item_ids"), "set_item_ids", "get_item_ids");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "call_script_check"), "set_call_script_check", "get_call_script_check");
     GDVIRTUAL_BIND(_can_add_on_position, "inventory", "position", "item_id", "amount", "properties", "is_rotated");
 }
 
@@ -10,7 +26,90 @@ GridInventoryConstraint::GridInventoryConstraint() {
 GridInventoryConstraint::~GridInventoryConstraint() {
 }
 
+void GridInventoryConstraint::set_allowed_cells(const PackedByteArray &new_allowed_cells) {
+	allowed_cells = new_allowed_cells;
+	cells_version++;
+}
+
+PackedByteArray GridInventoryConstraint::get_allowed_cells() const {
+	return allowed_cells;
+}
+
+void GridInventoryConstraint::set_allowed_cells_size(const Vector2i &new_allowed_cells_size) {
+	allowed_cells_size = new_allowed_cells_size;
+	cells_version++;
+}
+
+Vector2i GridInventoryConstraint::get_allowed_cells_size() const {
+	return allowed_cells_size;
+}
+
+void GridInventoryConstraint::set_categories(const TypedArray<ItemCategory> &new_categories) {
+	categories = new_categories;
+	cells_version++;
+}
+
+TypedArray<ItemCategory> GridInventoryConstraint::get_categories() const {
+	return categories;
+}
+
+void GridInventoryConstraint::set_item_ids(const PackedStringArray &new_item_ids) {
+	item_ids = new_item_ids;
+	cells_version++;
+}
+
+PackedStringArray GridInventoryConstraint::get_item_ids() const {
+	return item_ids;
+}
+
+void GridInventoryConstraint::set_call_script_check(const bool &new_call_script_check) {
+	call_script_check = new_call_script_check;
+	// Placement results cached against the cell version depend on this too.
+	cells_version++;
+}
+
+bool GridInventoryConstraint::get_call_script_check() const {
+	return call_script_check;
+}
+
+uint64_t GridInventoryConstraint::get_cells_version() const {
+	return cells_version;
+}
+
+bool GridInventoryConstraint::has_cell_mask() const {
+	return !allowed_cells.is_empty() && allowed_cells.size() == int64_t(allowed_cells_size.x) * allowed_cells_size.y;
+}
+
+bool GridInventoryConstraint::applies_to(const Ref<ItemDefinition> &definition) const {
+	// Without filters the cell mask applies to every item.
+	if (item_ids.is_empty() && categories.is_empty())
+		return true;
+	if (definition == nullptr)
+		return false;
+	if (item_ids.has(definition->get_id()))
+		return true;
+	for (int64_t i = 0; i < categories.size(); i++) {
+		Ref<ItemCategory> category = categories[i];
+		if (category != nullptr && definition->is_in_category(category))
+			return true;
+	}
+	return false;
+}
+
+bool GridInventoryConstraint::is_cell_allowed(const Vector2i &cell) const {
+	// Cells outside the mask are not restricted by it.
+	if (!has_cell_mask())
+		return true;
+	if (cell.x < 0 || cell.y < 0 || cell.x >= allowed_cells_size.x || cell.y >= allowed_cells_size.y)
+		return true;
+	return allowed_cells[cell.y * allowed_cells_size.x + cell.x] != 0;
+}
+
 bool GridInventoryConstraint::can_add_on_position(const Node* inventory_node, const Vector2i position, const String item_id, const int amount, const Dictionary properties, const bool is_rotated) {
+	// A constraint that publishes a cell mask is mask-only unless it opts in;
+	// without a mask the script is the only rule there is.
+	if (has_cell_mask() && !call_script_check)
+		return true;
     bool ret;
     if (GDVIRTUAL_CALL(_can_add_on_position, inventory_node, position, item_id, amount, properties, is_rotated, ret)) {
 		return ret;
@@ -7,12 +7,20 @@
 #include <godot_cpp/core/binder_common.hpp>
 #include <godot_cpp/core/gdvirtual.gen.inc>
 
+#include "base/item_definition.h"
+
 using namespace godot;
 
 class GridInventoryConstraint : public Resource {
 	GDCLASS(GridInventoryConstraint, Resource);
 
 private:
+	PackedByteArray allowed_cells;
+	Vector2i allowed_cells_size;
+	TypedArray<ItemCategory> categories;
+	PackedStringArray item_ids;
+	bool call_script_check = false;
+	uint64_t cells_version = 0;
 
 protected:
 	static void _bind_methods();
@@ -20,9 +28,23 @@ protected:
 public:
 	GridInventoryConstraint();
 	~GridInventoryConstraint();
+	void set_allowed_cells(const PackedByteArray &new_allowed_cells);
+	PackedByteArray get_allowed_cells() const;
+	void set_allowed_cells_size(const Vector2i &new_allowed_cells_size);
+	Vector2i get_allowed_cells_size() const;
+	void set_categories(const TypedArray<ItemCategory> &new_categories);
+	TypedArray<ItemCategory> get_categories() const;
+	void set_item_ids(const PackedStringArray &new_item_ids);
+	PackedStringArray get_item_ids() const;
+	void set_call_script_check(const bool &new_call_script_check);
+	bool get_call_script_check() const;
+	uint64_t get_cells_version() const;
+	bool has_cell_mask() const;
+	bool applies_to(const Ref<ItemDefinition> &definition) const;
+	bool is_cell_allowed(const Vector2i &cell) const;
 	virtual bool can_add_on_position(const Node* inventory_node, const Vector2i position, const String item_id, const int amount, const Dictionary properties, const bool is_rotated);
 	GDVIRTUAL6R(bool, _can_add_on_position, const Node*, Vector2i, String, int, Dictionary, bool);
 
 };
 
-#endif // GRID_INVENTORY_CONSTRAINT_CLASS_H
\ No newline at end of file
+#endif // GRID_INVENTORY_CONSTRAINT_CLASS_H
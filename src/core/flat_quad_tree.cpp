@@ -0,0 +1,464 @@
+#include "flat_quad_tree.h"
+
+#include <godot_cpp/core/error_macros.hpp>
+
+bool FlatQuadTree::_can_subdivide(const Vector2i &rect_size) {
+	return rect_size.x > 1 && rect_size.y > 1;
+}
+
+void FlatQuadTree::_get_quadrant_rects(const Rect2i &rect, Rect2i *result) {
+	// The first quadrant takes the larger half, as roundi(size / 2.0) did.
+	Vector2i q0_size = Vector2i((rect.size.x + 1) / 2, (rect.size.y + 1) / 2);
+	Rect2i q0 = Rect2i(rect.position, q0_size);
+	Rect2i q3 = Rect2i(rect.position + q0_size, rect.size - q0_size);
+	result[0] = q0;
+	result[1] = Rect2i(Vector2i(q3.position.x, q0.position.y), Vector2i(q3.size.x, q0.size.y));
+	result[2] = Rect2i(Vector2i(q0.position.x, q3.position.y), Vector2i(q0.size.x, q3.size.y));
+	result[3] = q3;
+}
+
+int32_t FlatQuadTree::_alloc_node(const Rect2i &rect) {
+	int32_t node_id = free_node;
+	if (node_id != INVALID) {
+		free_node = nodes[node_id].quadrants[0];
+	} else {
+		node_id = nodes.size();
+		nodes.push_back(Node());
+	}
+	Node &node = nodes[node_id];
+	node.rect = rect;
+	node.quadrants[0] = INVALID;
+	node.quadrants[1] = INVALID;
+	node.quadrants[2] = INVALID;
+	node.quadrants[3] = INVALID;
+	node.quadrant_count = 0;
+	node.first_entry = INVALID;
+	return node_id;
+}
+
+void FlatQuadTree::_free_node(const int32_t node_id) {
+	Node &node = nodes[node_id];
+	for (int i = 0; i < 4; i++) {
+		if (node.quadrants[i] != INVALID)
+			_free_node(node.quadrants[i]);
+	}
+	int32_t entry_id = node.first_entry;
+	while (entry_id != INVALID) {
+		int32_t next = entries[entry_id].next;
+		entries[entry_id].next = free_entry;
+		free_entry = entry_id;
+		entry_id = next;
+	}
+	node.first_entry = INVALID;
+	node.quadrants[0] = free_node;
+	free_node = node_id;
+}
+
+int32_t FlatQuadTree::_alloc_item(const Rect2i &rect, const int32_t payload) {
+	int32_t item_id = free_item;
+	if (item_id != INVALID) {
+		free_item = items[item_id].payload;
+	} else {
+		item_id = items.size();
+		items.push_back(Item());
+		item_stamps.push_back(0);
+	}
+	items[item_id].rect = rect;
+	items[item_id].payload = payload;
+	int32_t *first = payload_items.getptr(payload);
+	if (first == nullptr) {
+		items[item_id].next_of_payload = INVALID;
+		payload_items.insert(payload, item_id);
+	} else {
+		items[item_id].next_of_payload = *first;
+		*first = item_id;
+	}
+	return item_id;
+}
+
+void FlatQuadTree::_push_entry(const int32_t node_id, const int32_t item_id) {
+	int32_t entry_id = free_entry;
+	if (entry_id != INVALID) {
+		free_entry = entries[entry_id].next;
+	} else {
+		entry_id = entries.size();
+		entries.push_back(Entry());
+	}
+	entries[entry_id].item = item_id;
+	entries[entry_id].next = INVALID;
+	// Appended at the tail, so queries see rects in insertion order. Lists stay
+	// short because nodes split as soon as they hold a second rect.
+	int32_t *link = &nodes[node_id].first_entry;
+	while (*link != INVALID) {
+		link = &entries[*link].next;
+	}
+	*link = entry_id;
+}
+
+bool FlatQuadTree::_is_node_empty(const int32_t node_id) const {
+	return nodes[node_id].quadrant_count == 0 && nodes[node_id].first_entry == INVALID;
+}
+
+void FlatQuadTree::_add(const int32_t node_id, const int32_t item_id) {
+	// Node references are re-read after every allocation, since the pool may move.
+	if (!_can_subdivide(nodes[node_id].rect.size) || _is_node_empty(node_id)) {
+		_push_entry(node_id, item_id);
+		return;
+	}
+	Rect2i quadrant_rects[4];
+	_get_quadrant_rects(nodes[node_id].rect, quadrant_rects);
+	for (int i = 0; i < 4; i++) {
+		if (!quadrant_rects[i].intersects(items[item_id].rect))
+			continue;
+		int32_t quadrant = nodes[node_id].quadrants[i];
+		if (quadrant == INVALID) {
+			quadrant = _alloc_node(quadrant_rects[i]);
+			nodes[node_id].quadrants[i] = quadrant;
+			nodes[node_id].quadrant_count += 1;
+			// The rects kept while this node was a leaf move down into the quadrants.
+			while (nodes[node_id].first_entry != INVALID) {
+				int32_t entry_id = nodes[node_id].first_entry;
+				int32_t moved_item = entries[entry_id].item;
+				nodes[node_id].first_entry = entries[entry_id].next;
+				entries[entry_id].next = free_entry;
+				free_entry = entry_id;
+				_add(node_id, moved_item);
+			}
+		}
+		_add(quadrant, item_id);
+	}
+}
+
+void FlatQuadTree::_build(const int32_t node_id, const LocalVector<int32_t> &item_ids) {
+	// Same layout that successive add() calls settle into: a node keeps its rects
+	// when it holds a single one or cannot be split further.
+	if (item_ids.size() <= 1 || !_can_subdivide(nodes[node_id].rect.size)) {
+		for (uint32_t i = 0; i < item_ids.size(); i++) {
+			_push_entry(node_id, item_ids[i]);
+		}
+		return;
+	}
+	Rect2i quadrant_rects[4];
+	_get_quadrant_rects(nodes[node_id].rect, quadrant_rects);
+	LocalVector<int32_t> quadrant_items;
+	for (int i = 0; i < 4; i++) {
+		quadrant_items.clear();
+		for (uint32_t j = 0; j < item_ids.size(); j++) {
+			if (quadrant_rects[i].intersects(items[item_ids[j]].rect))
+				quadrant_items.push_back(item_ids[j]);
+		}
+		if (quadrant_items.is_empty())
+			continue;
+		int32_t quadrant = _alloc_node(quadrant_rects[i]);
+		nodes[node_id].quadrants[i] = quadrant;
+		nodes[node_id].quadrant_count += 1;
+		_build(quadrant, quadrant_items);
+	}
+}
+
+bool FlatQuadTree::_remove_item(const int32_t node_id, const int32_t item_id) {
+	// Only quadrants overlapping the rect can hold it, so the walk stays on its path.
+	bool result = false;
+	int32_t previous = INVALID;
+	int32_t entry_id = nodes[node_id].first_entry;
+	while (entry_id != INVALID) {
+		int32_t next = entries[entry_id].next;
+		if (entries[entry_id].item == item_id) {
+			if (previous == INVALID)
+				nodes[node_id].first_entry = next;
+			else
+				entries[previous].next = next;
+			entries[entry_id].next = free_entry;
+			free_entry = entry_id;
+			result = true;
+		} else {
+			previous = entry_id;
+		}
+		entry_id = next;
+	}
+	Rect2i rect = items[item_id].rect;
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = nodes[node_id].quadrants[i];
+		if (quadrant == INVALID || !nodes[quadrant].rect.intersects(rect))
+			continue;
+		if (_remove_item(quadrant, item_id))
+			result = true;
+		if (_is_node_empty(quadrant)) {
+			_free_node(quadrant);
+			nodes[node_id].quadrants[i] = INVALID;
+			nodes[node_id].quadrant_count -= 1;
+		}
+	}
+	_collapse(node_id);
+	return result;
+}
+
+void FlatQuadTree::_collect_item_nodes(const int32_t node_id, const int32_t item_id, LocalVector<int32_t> &result) const {
+	const Node &node = nodes[node_id];
+	for (int32_t entry_id = node.first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+		if (entries[entry_id].item == item_id) {
+			result.push_back(node_id);
+			break;
+		}
+	}
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = node.quadrants[i];
+		if (quadrant != INVALID && nodes[quadrant].rect.intersects(items[item_id].rect))
+			_collect_item_nodes(quadrant, item_id, result);
+	}
+}
+
+void FlatQuadTree::_collapse(const int32_t node_id) {
+	// Quadrants that are leaves all holding the same single rect fold back into this node.
+	if (nodes[node_id].quadrant_count == 0)
+		return;
+	int32_t collapsing_into = INVALID;
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = nodes[node_id].quadrants[i];
+		if (quadrant == INVALID)
+			continue;
+		if (nodes[quadrant].quadrant_count != 0)
+			return;
+		for (int32_t entry_id = nodes[quadrant].first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+			int32_t item_id = entries[entry_id].item;
+			if (collapsing_into != INVALID && collapsing_into != item_id)
+				return;
+			collapsing_into = item_id;
+		}
+	}
+	for (int i = 0; i < 4; i++) {
+		if (nodes[node_id].quadrants[i] != INVALID)
+			_free_node(nodes[node_id].quadrants[i]);
+		nodes[node_id].quadrants[i] = INVALID;
+	}
+	nodes[node_id].quadrant_count = 0;
+	if (collapsing_into != INVALID)
+		_push_entry(node_id, collapsing_into);
+}
+
+int32_t FlatQuadTree::_get_first(const int32_t node_id, const Rect2i &rect, const int32_t exception_payload) const {
+	const Node &node = nodes[node_id];
+	for (int32_t entry_id = node.first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+		const Item &item = items[entries[entry_id].item];
+		if (item.payload != exception_payload && item.rect.intersects(rect))
+			return entries[entry_id].item;
+	}
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = node.quadrants[i];
+		if (quadrant == INVALID || !nodes[quadrant].rect.intersects(rect))
+			continue;
+		int32_t first = _get_first(quadrant, rect, exception_payload);
+		if (first != INVALID)
+			return first;
+	}
+	return INVALID;
+}
+
+int32_t FlatQuadTree::_get_first_at(const int32_t node_id, const Vector2i &point, const int32_t exception_payload) const {
+	const Node &node = nodes[node_id];
+	for (int32_t entry_id = node.first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+		const Item &item = items[entries[entry_id].item];
+		if (item.payload != exception_payload && item.rect.has_point(point))
+			return entries[entry_id].item;
+	}
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = node.quadrants[i];
+		if (quadrant == INVALID || !nodes[quadrant].rect.has_point(point))
+			continue;
+		int32_t first = _get_first_at(quadrant, point, exception_payload);
+		if (first != INVALID)
+			return first;
+	}
+	return INVALID;
+}
+
+void FlatQuadTree::_get_all(const int32_t node_id, const Rect2i &rect, const int32_t exception_payload, LocalVector<int32_t> &result) const {
+	const Node &node = nodes[node_id];
+	for (int32_t entry_id = node.first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+		int32_t item_id = entries[entry_id].item;
+		const Item &item = items[item_id];
+		// Rects spanning several quadrants are stored in each, report them once.
+		if (item.payload == exception_payload || item_stamps[item_id] == query_stamp || !item.rect.intersects(rect))
+			continue;
+		item_stamps[item_id] = query_stamp;
+		result.push_back(item_id);
+	}
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = node.quadrants[i];
+		if (quadrant != INVALID && nodes[quadrant].rect.intersects(rect))
+			_get_all(quadrant, rect, exception_payload, result);
+	}
+}
+
+void FlatQuadTree::_get_all_at(const int32_t node_id, const Vector2i &point, const int32_t exception_payload, LocalVector<int32_t> &result) const {
+	const Node &node = nodes[node_id];
+	for (int32_t entry_id = node.first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+		int32_t item_id = entries[entry_id].item;
+		const Item &item = items[item_id];
+		if (item.payload == exception_payload || item_stamps[item_id] == query_stamp || !item.rect.has_point(point))
+			continue;
+		item_stamps[item_id] = query_stamp;
+		result.push_back(item_id);
+	}
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = node.quadrants[i];
+		if (quadrant != INVALID && nodes[quadrant].rect.has_point(point))
+			_get_all_at(quadrant, point, exception_payload, result);
+	}
+}
+
+void FlatQuadTree::_begin_query() const {
+	query_stamp++;
+	if (query_stamp == 0) {
+		for (uint32_t i = 0; i < item_stamps.size(); i++) {
+			item_stamps[i] = 0;
+		}
+		query_stamp = 1;
+	}
+}
+
+void FlatQuadTree::init(const Vector2i &new_size) {
+	size = new_size;
+	nodes.clear();
+	entries.clear();
+	items.clear();
+	item_stamps.clear();
+	payload_items.clear();
+	free_node = INVALID;
+	free_entry = INVALID;
+	free_item = INVALID;
+	_alloc_node(Rect2i(Vector2i(0, 0), size));
+}
+
+Vector2i FlatQuadTree::get_size() const {
+	return size;
+}
+
+void FlatQuadTree::add(const Rect2i &rect, const int32_t payload) {
+	ERR_FAIL_COND_MSG(nodes.is_empty(), "The quad tree is not initialized.");
+	_add(0, _alloc_item(rect, payload));
+}
+
+void FlatQuadTree::build(const LocalVector<Rect2i> &rects, const LocalVector<int32_t> &payloads) {
+	ERR_FAIL_COND_MSG(rects.size() != payloads.size(), "'rects' and 'payloads' must have the same size.");
+	init(size);
+	LocalVector<int32_t> item_ids;
+	item_ids.resize(rects.size());
+	for (uint32_t i = 0; i < rects.size(); i++) {
+		item_ids[i] = _alloc_item(rects[i], payloads[i]);
+	}
+	_build(0, item_ids);
+}
+
+bool FlatQuadTree::remove(const int32_t payload) {
+	ERR_FAIL_COND_V_MSG(nodes.is_empty(), false, "The quad tree is not initialized.");
+	const int32_t *first = payload_items.getptr(payload);
+	if (first == nullptr)
+		return false;
+	bool result = false;
+	int32_t item_id = *first;
+	payload_items.erase(payload);
+	while (item_id != INVALID) {
+		int32_t next = items[item_id].next_of_payload;
+		if (_remove_item(0, item_id))
+			result = true;
+		items[item_id].payload = free_item;
+		free_item = item_id;
+		item_id = next;
+	}
+	return result;
+}
+
+bool FlatQuadTree::move(const int32_t payload, const Rect2i &new_rect) {
+	ERR_FAIL_COND_V_MSG(nodes.is_empty(), false, "The quad tree is not initialized.");
+	const int32_t *first = payload_items.getptr(payload);
+	if (first == nullptr)
+		return false;
+	int32_t item_id = *first;
+	if (items[item_id].next_of_payload == INVALID && new_rect.size.x > 0 && new_rect.size.y > 0) {
+		// Leaves never overlap, so the new rect lands in exactly the same leaves
+		// when it touches each of them and they cover all of it.
+		LocalVector<int32_t> item_nodes;
+		_collect_item_nodes(0, item_id, item_nodes);
+		int64_t covered_area = 0;
+		bool same_nodes = !item_nodes.is_empty();
+		for (uint32_t i = 0; i < item_nodes.size() && same_nodes; i++) {
+			Rect2i node_rect = nodes[item_nodes[i]].rect;
+			if (nodes[item_nodes[i]].quadrant_count != 0 || !node_rect.intersects(new_rect))
+				same_nodes = false;
+			else
+				covered_area += node_rect.intersection(new_rect).get_area();
+		}
+		if (same_nodes && covered_area == int64_t(new_rect.size.x) * new_rect.size.y) {
+			items[item_id].rect = new_rect;
+			return true;
+		}
+	}
+	remove(payload);
+	add(new_rect, payload);
+	return true;
+}
+
+bool FlatQuadTree::has_payload(const int32_t payload) const {
+	return payload_items.has(payload);
+}
+
+bool FlatQuadTree::is_empty() const {
+	return nodes.is_empty() || _is_node_empty(0);
+}
+
+int32_t FlatQuadTree::get_first(const Rect2i &rect, const int32_t exception_payload) const {
+	if (nodes.is_empty())
+		return INVALID;
+	return _get_first(0, rect, exception_payload);
+}
+
+int32_t FlatQuadTree::get_first_at(const Vector2i &point, const int32_t exception_payload) const {
+	if (nodes.is_empty())
+		return INVALID;
+	return _get_first_at(0, point, exception_payload);
+}
+
+void FlatQuadTree::get_all(const Rect2i &rect, LocalVector<int32_t> &result, const int32_t exception_payload) const {
+	if (nodes.is_empty())
+		return;
+	_begin_query();
+	_get_all(0, rect, exception_payload, result);
+}
+
+void FlatQuadTree::get_all_at(const Vector2i &point, LocalVector<int32_t> &result, const int32_t exception_payload) const {
+	if (nodes.is_empty())
+		return;
+	_begin_query();
+	_get_all_at(0, point, exception_payload, result);
+}
+
+Rect2i FlatQuadTree::get_item_rect(const int32_t item_id) const {
+	return items[item_id].rect;
+}
+
+int32_t FlatQuadTree::get_item_payload(const int32_t item_id) const {
+	return items[item_id].payload;
+}
+
+int32_t FlatQuadTree::get_root() const {
+	return nodes.is_empty() ? INVALID : 0;
+}
+
+Rect2i FlatQuadTree::get_node_rect(const int32_t node_id) const {
+	return nodes[node_id].rect;
+}
+
+int32_t FlatQuadTree::get_node_quadrant(const int32_t node_id, const int quadrant_index) const {
+	return nodes[node_id].quadrants[quadrant_index];
+}
+
+int32_t FlatQuadTree::get_node_quadrant_count(const int32_t node_id) const {
+	return nodes[node_id].quadrant_count;
+}
+
+void FlatQuadTree::get_node_items(const int32_t node_id, LocalVector<int32_t> &result) const {
+	for (int32_t entry_id = nodes[node_id].first_entry; entry_id != INVALID; entry_id = entries[entry_id].next) {
+		result.push_back(entries[entry_id].item);
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef FLAT_QUAD_TREE_H
+#define FLAT_QUAD_TREE_H
+
+#include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/variant/rect2i.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+using namespace godot;
+
+// Quad tree over integer rects with integer payloads. Nodes, rects and the
+// per-node rect lists live in pools indexed by int32_t, so queries never touch
+// refcounts or Variants. Freed slots are reused through free lists.
+class FlatQuadTree {
+public:
+	static const int32_t INVALID = -1;
+
+private:
+	struct Node {
+		Rect2i rect;
+		int32_t quadrants[4];
+		int32_t quadrant_count;
+		int32_t first_entry;
+	};
+	struct Entry {
+		int32_t item;
+		int32_t next;
+	};
+	struct Item {
+		Rect2i rect;
+		int32_t payload;
+		int32_t next_of_payload;
+	};
+
+	Vector2i size;
+	LocalVector<Node> nodes;
+	LocalVector<Entry> entries;
+	LocalVector<Item> items;
+	int32_t free_node = INVALID;
+	int32_t free_entry = INVALID;
+	int32_t free_item = INVALID;
+	// First item of each payload, further ones are chained through next_of_payload.
+	HashMap<int32_t, int32_t> payload_items;
+	mutable LocalVector<uint32_t> item_stamps;
+	mutable uint32_t query_stamp = 0;
+
+	static bool _can_subdivide(const Vector2i &rect_size);
+	static void _get_quadrant_rects(const Rect2i &rect, Rect2i *result);
+	int32_t _alloc_node(const Rect2i &rect);
+	void _free_node(const int32_t node_id);
+	int32_t _alloc_item(const Rect2i &rect, const int32_t payload);
+	void _push_entry(const int32_t node_id, const int32_t item_id);
+	bool _is_node_empty(const int32_t node_id) const;
+	void _add(const int32_t node_id, const int32_t item_id);
+	void _build(const int32_t node_id, const LocalVector<int32_t> &item_ids);
+	bool _remove_item(const int32_t node_id, const int32_t item_id);
+	void _collect_item_nodes(const int32_t node_id, const int32_t item_id, LocalVector<int32_t> &result) const;
+	void _collapse(const int32_t node_id);
+	int32_t _get_first(const int32_t node_id, const Rect2i &rect, const int32_t exception_payload) const;
+	int32_t _get_first_at(const int32_t node_id, const Vector2i &point, const int32_t exception_payload) const;
+	void _get_all(const int32_t node_id, const Rect2i &rect, const int32_t exception_payload, LocalVector<int32_t> &result) const;
+	void _get_all_at(const int32_t node_id, const Vector2i &point, const int32_t exception_payload, LocalVector<int32_t> &result) const;
+	void _begin_query() const;
+
+public:
+	void init(const Vector2i &new_size);
+	Vector2i get_size() const;
+	void add(const Rect2i &rect, const int32_t payload);
+	void build(const LocalVector<Rect2i> &rects, const LocalVector<int32_t> &payloads);
+	bool remove(const int32_t payload);
+	bool move(const int32_t payload, const Rect2i &new_rect);
+	bool has_payload(const int32_t payload) const;
+	bool is_empty() const;
+
+	// Queries return item ids; read them with get_item_rect/get_item_payload.
+	int32_t get_first(const Rect2i &rect, const int32_t exception_payload = INVALID) const;
+	int32_t get_first_at(const Vector2i &point, const int32_t exception_payload = INVALID) const;
+	void get_all(const Rect2i &rect, LocalVector<int32_t> &result, const int32_t exception_payload = INVALID) const;
+	void get_all_at(const Vector2i &point, LocalVector<int32_t> &result, const int32_t exception_payload = INVALID) const;
+	Rect2i get_item_rect(const int32_t item_id) const;
+	int32_t get_item_payload(const int32_t item_id) const;
+
+	// Read-only access to the node layout, for the scripting wrappers.
+	int32_t get_root() const;
+	Rect2i get_node_rect(const int32_t node_id) const;
+	int32_t get_node_quadrant(const int32_t node_id, const int quadrant_index) const;
+	int32_t get_node_quadrant_count(const int32_t node_id) const;
+	void get_node_items(const int32_t node_id, LocalVector<int32_t> &result) const;
+};
+
+#endif // FLAT_QUAD_TREE_H
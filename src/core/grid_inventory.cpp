@@ -1,5 +1,6 @@
 #include "grid_inventory.h"
 #include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/time.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
 void GridInventory::_enter_tree() {
@@ -7,24 +8,197 @@ void GridInventory::_enter_tree() {
 }
 
 bool GridInventory::_bounds_broken() const {
-	for (size_t i = 0; i < get_stacks().size(); i++) {
-		Ref<ItemStack> stack = get_stacks()[i];
-		if (!rect_free(get_stack_rect(stack), stack))
+	_ensure_loaded();
+	// Stacks are only ever placed on free cells, so the grid can only be
+	// broken by stacks sticking out of it; no occupancy test is needed.
+	for (uint32_t i = 0; i < slots.size(); i++) {
+		const GridSlot &slot = slots[i];
+		if (slot.stack_index == -1 || !slot.is_placed)
+			continue;
+		const Rect2i &rect = slot.rect;
+		if (rect.position.x < 0 || rect.position.y < 0 || rect.position.x + rect.size.x > size.x || rect.position.y + rect.size.y > size.y)
 			return true;
 	}
 	return false;
 }
 
 void GridInventory::_refresh_quad_tree() {
+	_rebuild_slots();
 	Ref<QuadTree> new_quad_tree = memnew(QuadTree());
-	new_quad_tree->init(size);
+	new_quad_tree->set_size(size);
+	TypedArray<Rect2i> rects = TypedArray<Rect2i>();
+	Array metadatas = Array();
+	occupancy.resize(size);
+	for (size_t i = 0; i < stacks.size(); i++) {
+		Ref<ItemStack> stack = stacks[i];
+		if (stack == nullptr)
+			continue;
+		GridSlot &slot = slots[_get_slot(stack)];
+		slot.rect = _make_stack_rect(stack, slot.position, slot.is_rotated);
+		slot.is_placed = true;
+		slot.is_placed_rotated = slot.is_rotated;
+		rects.append(slot.rect);
+		metadatas.append(stack);
+		occupancy.fill_shape(_get_placed_shape(stack));
+	}
+	new_quad_tree->build(rects, metadatas);
 	set_quad_tree(new_quad_tree);
-	for (size_t i = 0; i < get_stacks().size(); i++) {
-		Ref<ItemStack> stack = get_stacks()[i];
-		quad_tree->add(get_stack_rect(stack), stack);
+}
+
+void GridInventory::_rebuild_slots() {
+	// Slots follow the stacks array, taking their state from the loaded
+	// arrays if those were set since the last rebuild.
+	LocalVector<GridSlot> new_slots;
+	HashMap<uint64_t, int32_t> new_slot_ids;
+	for (size_t i = 0; i < stacks.size(); i++) {
+		Ref<ItemStack> stack = stacks[i];
+		if (stack == nullptr)
+			continue;
+		GridSlot slot;
+		if (_slots_dirty) {
+			slot.position = i < stack_positions.size() ? Vector2i(stack_positions[i]) : Vector2i(0, 0);
+			slot.is_rotated = i < stack_rotations.size() ? bool(stack_rotations[i]) : false;
+		} else {
+			int32_t old_slot = _get_slot(stack);
+			if (old_slot != -1) {
+				slot.position = slots[old_slot].position;
+				slot.is_rotated = slots[old_slot].is_rotated;
+			}
+		}
+		slot.stack_index = i;
+		new_slot_ids.insert(stack->get_instance_id(), new_slots.size());
+		new_slots.push_back(slot);
+	}
+	slots = new_slots;
+	slot_ids = new_slot_ids;
+	_first_free_slot = -1;
+	stack_positions.clear();
+	stack_rotations.clear();
+	_slots_dirty = false;
+}
+
+int32_t GridInventory::_get_slot(const Ref<ItemStack> &stack) const {
+	if (stack == nullptr)
+		return -1;
+	const int32_t *slot = slot_ids.getptr(stack->get_instance_id());
+	return slot == nullptr ? -1 : *slot;
+}
+
+int32_t GridInventory::_create_slot(const Ref<ItemStack> &stack, const int stack_index, const Vector2i &position, const bool is_rotated) {
+	int32_t slot_id = _first_free_slot;
+	if (slot_id == -1) {
+		slot_id = slots.size();
+		slots.push_back(GridSlot());
+	} else {
+		_first_free_slot = slots[slot_id].next_free;
+	}
+	GridSlot &slot = slots[slot_id];
+	slot = GridSlot();
+	slot.position = position;
+	slot.is_rotated = is_rotated;
+	slot.stack_index = stack_index;
+	slot_ids.insert(stack->get_instance_id(), slot_id);
+	return slot_id;
+}
+
+void GridInventory::_free_slot(const Ref<ItemStack> &stack) {
+	int32_t slot_id = _get_slot(stack);
+	if (slot_id == -1)
+		return;
+	slot_ids.erase(stack->get_instance_id());
+	slots[slot_id].stack_index = -1;
+	slots[slot_id].next_free = _first_free_slot;
+	_first_free_slot = slot_id;
+}
+
+void GridInventory::_reindex_slots(const int from_stack_index) {
+	for (int i = from_stack_index; i < stacks.size(); i++) {
+		int32_t slot_id = _get_slot(stacks[i]);
+		if (slot_id != -1)
+			slots[slot_id].stack_index = i;
+	}
+}
+
+int GridInventory::_get_stack_index(const Ref<ItemStack> &stack) const {
+	int32_t slot_id = _get_slot(stack);
+	return slot_id == -1 ? -1 : slots[slot_id].stack_index;
+}
+
+void GridInventory::_place_stack_unsafe(const Ref<ItemStack> &stack, const Rect2i &rect) {
+	int32_t slot_id = _get_slot(stack);
+	ERR_FAIL_COND_MSG(slot_id == -1, "The stack has no grid slot.");
+	quad_tree->add(rect, stack);
+	slots[slot_id].rect = rect;
+	slots[slot_id].is_placed = true;
+	slots[slot_id].is_placed_rotated = slots[slot_id].is_rotated;
+	occupancy.fill_shape(_get_placed_shape(stack));
+}
+
+const uint64_t *GridInventory::_get_shape_rows(const String &item_id, const bool is_rotated) const {
+	if (get_database() == nullptr)
+		return nullptr;
+	Ref<ItemDefinition> definition = get_database()->get_item(item_id);
+	if (definition == nullptr)
+		return nullptr;
+	return definition->get_shape_rows(is_rotated);
+}
+
+GridShape GridInventory::_get_item_shape(const String &item_id, const Rect2i &rect, const bool is_rotated) const {
+	return GridShape(rect, _get_shape_rows(item_id, is_rotated));
+}
+
+GridShape GridInventory::_get_placed_shape(const Ref<ItemStack> &stack) const {
+	int32_t slot_id = _get_slot(stack);
+	if (slot_id == -1 || !slots[slot_id].is_placed)
+		return GridShape();
+	const GridSlot &slot = slots[slot_id];
+	return _get_item_shape(stack->get_item_id(), slot.rect, slot.is_placed_rotated);
+}
+
+bool GridInventory::_shape_free(const GridShape &shape, const Ref<ItemStack> &exception) const {
+	_ensure_loaded();
+	const Rect2i &rect = shape.rect;
+	if (rect.position.x < 0 || rect.position.y < 0 || rect.size.x < 1 || rect.size.y < 1)
+		return false;
+	if (rect.position.x + rect.size.x > size.x)
+		return false;
+	if (rect.position.y + rect.size.y > size.y)
+		return false;
+	return occupancy.is_shape_free(shape, _get_placed_shape(exception));
+}
+
+void GridInventory::_unplace_stack_unsafe(const Ref<ItemStack> &stack) {
+	quad_tree->remove(stack);
+	int32_t slot_id = _get_slot(stack);
+	if (slot_id == -1 || !slots[slot_id].is_placed)
+		return;
+	GridShape shape = _get_placed_shape(stack);
+	slots[slot_id].is_placed = false;
+	_clear_occupancy(shape);
+}
+
+void GridInventory::_clear_occupancy(const GridShape &shape) {
+	occupancy.clear_shape(shape);
+	// Stacks only overlap while bounds are broken, but their cells must survive.
+	LocalVector<int32_t> overlapping;
+	quad_tree->query_rect(shape.rect, overlapping);
+	for (uint32_t i = 0; i < overlapping.size(); i++) {
+		Ref<ItemStack> other = quad_tree->get_metadata_by_id(overlapping[i]);
+		occupancy.fill_shape(_get_placed_shape(other));
 	}
 }
 
+Rect2i GridInventory::_make_stack_rect(const Ref<ItemStack> &stack, const Vector2i &position, const bool is_rotated) const {
+	ERR_FAIL_NULL_V_MSG(get_database(), Rect2i(position, Vector2i()), "'database' is null.");
+	Ref<ItemDefinition> definition = get_database()->get_item(stack->get_item_id());
+	if (definition == nullptr)
+		return Rect2i(position, Vector2i());
+	Vector2i item_size = definition->get_size();
+	if (is_rotated)
+		item_size = Vector2i(item_size.y, item_size.x);
+	return Rect2i(position, item_size);
+}
+
 void GridInventory::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_size", "size"), &GridInventory::set_size);
 	ClassDB::bind_method(D_METHOD("get_size"), &GridInventory::get_size);
@@ -51,10 +225,19 @@ void GridInventory::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_stacks_under", "rect"), &GridInventory::get_stacks_under);
 	// ClassDB::bind_method(D_METHOD("move_stack_to", "stack", "position"), &GridInventory::move_stack_to);
 	ClassDB::bind_method(D_METHOD("transfer_to", "from_position", "destination", "destination_position", "amount", "is_rotated"), &GridInventory::transfer_to, DEFVAL(1), DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("transfer_stack_to", "from_position", "destination", "destination_position", "is_rotated"), &GridInventory::transfer_stack_to, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("swap_stacks", "position", "other_inventory", "other_position"), &GridInventory::swap_stacks);
+	ClassDB::bind_method(D_METHOD("add_batch", "items"), &GridInventory::add_batch);
+	ClassDB::bind_method(D_METHOD("get_placement_mask", "item_size", "is_rotated", "item_id", "amount", "properties", "exception"), &GridInventory::get_placement_mask, DEFVAL(false), DEFVAL(""), DEFVAL(1), DEFVAL(Dictionary()), DEFVAL(nullptr));
+	ClassDB::bind_method(D_METHOD("update_placement_mask", "mask", "changed_rect", "item_size", "is_rotated", "item_id", "amount", "properties", "exception"), &GridInventory::update_placement_mask, DEFVAL(false), DEFVAL(""), DEFVAL(1), DEFVAL(Dictionary()), DEFVAL(nullptr));
 	ClassDB::bind_method(D_METHOD("rect_free", "rect", "exception"), &GridInventory::rect_free, DEFVAL(nullptr));
 	// ClassDB::bind_method(D_METHOD("find_free_place", "stack_size", "exception"), &GridInventory::find_free_place, DEFVAL(nullptr));
-	ClassDB::bind_method(D_METHOD("sort"), &GridInventory::sort);
+	ClassDB::bind_method(D_METHOD("sort", "time_budget_usec", "sort_key"), &GridInventory::sort, DEFVAL(0), DEFVAL(SORT_BY_AREA));
+
+	BIND_ENUM_CONSTANT(SORT_BY_AREA);
+	BIND_ENUM_CONSTANT(SORT_BY_HEIGHT);
+	BIND_ENUM_CONSTANT(SORT_BY_WIDTH);
+	BIND_ENUM_CONSTANT(SORT_BY_ITEM_ID);
 
 	ADD_SIGNAL(MethodInfo("size_changed"));
 
@@ -78,7 +261,8 @@ void GridInventory::set_size(const Vector2i &new_size) {
 		return;
 	Vector2i old_size = size;
 	size = new_size;
-	if (!Engine::get_singleton()->is_editor_hint()) {
+	bool is_shrinking = size.x < old_size.x || size.y < old_size.y;
+	if (is_shrinking && !Engine::get_singleton()->is_editor_hint()) {
 		if (_bounds_broken())
 			size = old_size;
 	}
@@ -94,6 +278,7 @@ Vector2i GridInventory::get_size() const {
 
 void GridInventory::set_grid_constraints(const TypedArray<GridInventoryConstraint> &new_grid_constraints) {
 	grid_constraints = new_grid_constraints;
+	_placement_cached = false;
 }
 
 TypedArray<GridInventoryConstraint> GridInventory::get_grid_constraints() const {
@@ -108,42 +293,82 @@ Ref<QuadTree> GridInventory::get_quad_tree() const {
 	return quad_tree;
 }
 
+void GridInventory::set_stacks(const TypedArray<ItemStack> &new_stacks) {
+	// Positions and rotations stay index-aligned, as in the saved arrays.
+	if (!_slots_dirty) {
+		stack_positions = get_stack_positions();
+		stack_rotations = get_stack_rotations();
+	}
+	Inventory::set_stacks(new_stacks);
+	_slots_dirty = true;
+	if (quad_tree != nullptr)
+		_refresh_quad_tree();
+}
+
 void GridInventory::set_stack_positions(const TypedArray<Vector2i> &new_stack_positions) {
+	if (!_slots_dirty)
+		stack_rotations = get_stack_rotations();
 	stack_positions = new_stack_positions;
+	_slots_dirty = true;
+	if (quad_tree != nullptr)
+		_refresh_quad_tree();
 }
 
 TypedArray<Vector2i> GridInventory::get_stack_positions() const {
-	return stack_positions;
+	_ensure_loaded();
+	if (_slots_dirty)
+		return stack_positions;
+	TypedArray<Vector2i> result = TypedArray<Vector2i>();
+	result.resize(stacks.size());
+	for (size_t i = 0; i < stacks.size(); i++) {
+		int32_t slot_id = _get_slot(stacks[i]);
+		result[i] = slot_id == -1 ? Vector2i(0, 0) : slots[slot_id].position;
+	}
+	return result;
 }
 
 void GridInventory::set_stack_rotations(const TypedArray<bool> &new_stack_rotations) {
+	if (!_slots_dirty)
+		stack_positions = get_stack_positions();
 	stack_rotations = new_stack_rotations;
+	_slots_dirty = true;
+	if (quad_tree != nullptr)
+		_refresh_quad_tree();
 }
 
 TypedArray<bool> GridInventory::get_stack_rotations() const {
-	return stack_rotations;
+	_ensure_loaded();
+	if (_slots_dirty)
+		return stack_rotations;
+	TypedArray<bool> result = TypedArray<bool>();
+	result.resize(stacks.size());
+	for (size_t i = 0; i < stacks.size(); i++) {
+		int32_t slot_id = _get_slot(stacks[i]);
+		result[i] = slot_id != -1 && slots[slot_id].is_rotated;
+	}
+	return result;
 }
 
 Vector2i GridInventory::get_stack_position(const Ref<ItemStack> &stack) const {
+	_ensure_loaded();
+
 	ERR_FAIL_NULL_V_MSG(stack, Vector2i(0, 0), "stack' is null.");
 
-	int stack_index = stacks.find(stack);
-	if (stack_index == -1)
+	int32_t slot_id = _get_slot(stack);
+	if (slot_id == -1)
 		return Vector2i(0, 0);
-
-	ERR_FAIL_COND_V_MSG(stack_index >= stack_positions.size(), Vector2i(0, 0), "stack_index' is out of bounds for stack_positions.");
-	return stack_positions[stack_index];
+	return slots[slot_id].position;
 }
 
 bool GridInventory::set_stack_position(const Ref<ItemStack> &stack, const Vector2i new_position) {
+	_ensure_loaded();
 	Rect2i new_rect = Rect2i(new_position, get_stack_size(stack));
-	if (has_stack(stack) && !rect_free(new_rect, stack))
+	if (has_stack(stack) && !_shape_free(_get_item_shape(stack->get_item_id(), new_rect, is_stack_rotated(stack)), stack))
 		return false;
 
-	int stack_index = stacks.find(stack);
-	if (stack_index == -1)
+	if (_get_slot(stack) == -1)
 		return false;
-	stack_positions[stack_index] = new_position;
+	_move_stack_to_unsafe(stack, new_position);
 	return true;
 }
 
@@ -152,7 +377,7 @@ bool GridInventory::can_rotate_item(const Ref<ItemStack> &stack) const {
 	int temp = rotated_rect.size.x;
 	rotated_rect.size.x = rotated_rect.size.y;
 	rotated_rect.size.y = temp;
-	return rect_free(rotated_rect, stack);
+	return _shape_free(_get_item_shape(stack->get_item_id(), rotated_rect, !is_stack_rotated(stack)), stack);
 }
 
 void GridInventory::rotate(const Ref<ItemStack> &stack) {
@@ -165,14 +390,14 @@ void GridInventory::rotate(const Ref<ItemStack> &stack) {
 }
 
 bool GridInventory::is_stack_rotated(const Ref<ItemStack> &stack) const {
+	_ensure_loaded();
+
 	ERR_FAIL_NULL_V_MSG(stack, false, "stack' is null.");
 
-	int stack_index = stacks.find(stack);
-	if (stack_index == -1)
+	int32_t slot_id = _get_slot(stack);
+	if (slot_id == -1)
 		return false;
-
-	ERR_FAIL_COND_V_MSG(stack_index >= stack_rotations.size(), false, "stack_index' is out of bounds for stack_rotations.");
-	return stack_rotations[stack_index];
+	return slots[slot_id].is_rotated;
 }
 
 Vector2i GridInventory::get_stack_size(const Ref<ItemStack> &stack) const {
@@ -194,32 +419,43 @@ Rect2i GridInventory::get_stack_rect(const Ref<ItemStack> &stack) const {
 }
 
 Ref<ItemStack> GridInventory::get_stack_at(const Vector2i position) const {
-	Ref<QuadTree::QuadRect> first = quad_tree->get_first(position);
-	if (first == nullptr)
-		return nullptr;
-	return first->get_metadata();
+	_ensure_loaded();
+	ERR_FAIL_NULL_V_MSG(quad_tree, nullptr, "'quad_tree' is null.");
+	LocalVector<int32_t> ids;
+	quad_tree->query_point(position, ids);
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		// The tree holds bounding rects; shaped stacks may leave the cell empty.
+		Ref<ItemStack> stack = quad_tree->get_metadata_by_id(ids[i]);
+		if (_get_placed_shape(stack).has_cell(position))
+			return stack;
+	}
+	return nullptr;
 }
 
 int GridInventory::get_stack_index_at(const Vector2i position) const {
+	_ensure_loaded();
 	Ref<ItemStack> stack = get_stack_at(position);
 	if (stack == nullptr)
 		return -1;
-	int stack_index = stacks.find(stack);
-	return stack_index;
+	return _get_stack_index(stack);
 }
 
 TypedArray<ItemStack> GridInventory::get_stacks_under(const Rect2i rect) const {
+	_ensure_loaded();
 	TypedArray<ItemStack> result = TypedArray<ItemStack>();
-	for (size_t i = 0; i < stacks.size(); i++) {
-		Ref<ItemStack> stack = stacks[i];
-		Rect2i stack_rect = get_stack_rect(stack);
-		if (stack_rect.intersects(rect))
+	ERR_FAIL_NULL_V_MSG(quad_tree, result, "'quad_tree' is null.");
+	LocalVector<int32_t> ids;
+	quad_tree->query_rect(rect, ids);
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		Ref<ItemStack> stack = quad_tree->get_metadata_by_id(ids[i]);
+		if (_get_placed_shape(stack).intersects(rect))
 			result.append(stack);
 	}
 	return result;
 }
 
 int GridInventory::add_at_position(const Vector2i position, const String item_id, const int amount, const Dictionary &properties, const bool is_rotated) {
+	_ensure_loaded();
 	int stack_index = get_stack_index_at(position);
 	if (stack_index == -1) {
 		Ref<ItemDefinition> definition = get_database()->get_item(item_id);
@@ -230,12 +466,16 @@ int GridInventory::add_at_position(const Vector2i position, const String item_id
 			size = definition->get_size();
 		}
 		Rect2i rect = Rect2i(position, size);
-		if (rect_free(rect) && _can_add_on_position(position, item_id, amount, properties, is_rotated)) {
+		if (_shape_free(_get_item_shape(item_id, rect, is_rotated)) && _can_add_on_position(position, item_id, amount, properties, is_rotated)) {
 			int no_added = add_on_new_stack(item_id, amount, properties, false);
 			if (no_added == amount)
 				return amount;
 			Ref<ItemStack> stack = stacks[stacks.size() - 1];
-			stack_rotations[stacks.size() - 1] = is_rotated;
+			int32_t slot_id = _get_slot(stack);
+			if (slot_id != -1)
+				slots[slot_id].is_rotated = is_rotated;
+			if (_is_recording_ops())
+				_begin_op(OP_ROTATE, stacks.size() - 1).put_u8(is_rotated);
 			bool move_success = move_stack_to(stack, position);
 			if (!move_success)
 				UtilityFunctions::printerr("Can't move the item to the given place!");
@@ -255,7 +495,7 @@ int GridInventory::add_at_position(const Vector2i position, const String item_id
 bool GridInventory::move_stack_to(const Ref<ItemStack> stack, const Vector2i position) {
 	Vector2i stack_size = get_stack_size(stack);
 	Rect2i rect = Rect2i(position, stack_size);
-	if (rect_free(rect, stack)) {
+	if (_shape_free(_get_item_shape(stack->get_item_id(), rect, is_stack_rotated(stack)), stack)) {
 		_move_stack_to_unsafe(stack, position);
 		_flag_contents_changed = true;
 		return true;
@@ -264,6 +504,8 @@ bool GridInventory::move_stack_to(const Ref<ItemStack> stack, const Vector2i pos
 }
 
 int GridInventory::transfer_to(const Vector2i from_position, GridInventory *destination, const Vector2i destination_position, const int &amount, const bool is_rotated) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(from_position.x < 0 || from_position.x >= size.x, amount, "from_position.x' is out of size grid bounds.");
 	ERR_FAIL_COND_V_MSG(from_position.y < 0 || from_position.y >= size.y, amount, "from_position.x' is out of size grid bounds.");
 	ERR_FAIL_NULL_V_MSG(destination, amount, "Destination inventory is null on transfer.");
@@ -282,7 +524,7 @@ int GridInventory::transfer_to(const Vector2i from_position, GridInventory *dest
 		return amount;
 
 	int amount_of_stack = stack->get_amount();
-	int stack_index = stacks.find(stack);
+	int stack_index = _get_stack_index(stack);
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), amount, "The 'stack index' is out of bounds.");
 
 	String item_id = stack->get_item_id();
@@ -301,8 +543,11 @@ int GridInventory::transfer_to(const Vector2i from_position, GridInventory *dest
 
 	int amount_not_transferred = 0;
 
+	Ref<ItemStack> destination_stack = destination->get_stack_at(destination_position);
 	if (amount == amount_of_stack && swap_stacks(from_position, destination, destination_position)) {
 		amount_not_transferred = 0;
+	} else if (amount == amount_of_stack && (destination_stack == nullptr || destination_stack == stack) && transfer_stack_to(from_position, destination, destination_position, is_rotated)) {
+		amount_not_transferred = 0;
 	} else {
 		int amount_not_removed = remove_at(stack_index, item_id, amount_to_interact);
 		int amount_to_transfer = amount_to_interact - amount_not_removed;
@@ -325,7 +570,59 @@ int GridInventory::transfer_to(const Vector2i from_position, GridInventory *dest
 	return amount_not_transferred;
 }
 
+bool GridInventory::transfer_stack_to(const Vector2i from_position, GridInventory *destination, const Vector2i destination_position, const bool is_rotated) {
+	_ensure_loaded();
+
+	ERR_FAIL_NULL_V_MSG(destination, false, "Destination inventory is null on transfer.");
+	ERR_FAIL_NULL_V_MSG(get_database(), false, "InventoryDatabase is null.");
+	ERR_FAIL_COND_V_MSG(get_database() != destination->get_database(), false, "Operation between inventories that do not have the same database is invalid.");
+
+	Ref<ItemStack> stack = get_stack_at(from_position);
+	if (stack == nullptr)
+		return false;
+	int stack_index = _get_stack_index(stack);
+	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), false, "The 'stack index' is out of bounds.");
+	destination->_ensure_loaded();
+
+	String item_id = stack->get_item_id();
+	int amount = stack->get_amount();
+	Dictionary properties = stack->get_properties();
+	Rect2i rect = _make_stack_rect(stack, destination_position, is_rotated);
+	Ref<ItemStack> exception = destination == this ? stack : Ref<ItemStack>();
+	if (!destination->_shape_free(destination->_get_item_shape(item_id, rect, is_rotated), exception))
+		return false;
+	if (!destination->_can_add_on_position(destination_position, item_id, amount, properties, is_rotated))
+		return false;
+
+	if (destination == this) {
+		GridSlot &slot = slots[_get_slot(stack)];
+		if (slot.is_rotated != is_rotated) {
+			slot.is_rotated = is_rotated;
+			if (_is_recording_ops())
+				_begin_op(OP_ROTATE, stack_index).put_u8(is_rotated);
+		}
+		_move_stack_to_unsafe(stack, destination_position);
+		_flag_contents_changed = true;
+		return true;
+	}
+
+	if (!destination->Inventory::can_add_new_stack(item_id, amount, properties))
+		return false;
+	if (!_can_swap_to_inventory(destination, item_id, amount, properties))
+		return false;
+	_detach_stack(stack_index);
+	destination->_has_insert_placement = true;
+	destination->_insert_position = destination_position;
+	destination->_insert_rotated = is_rotated;
+	destination->_attach_stack(stack);
+	destination->_has_insert_placement = false;
+	return true;
+}
+
 bool GridInventory::swap_stacks(const Vector2i position, GridInventory *other_inventory, const Vector2i other_position) {
+	ERR_FAIL_NULL_V_MSG(other_inventory, false, "'other_inventory' is null.");
+	_ensure_loaded();
+	other_inventory->_ensure_loaded();
 	Ref<ItemStack> stack = get_stack_at(position);
 	if (stack == nullptr)
 		return false;
@@ -334,12 +631,14 @@ bool GridInventory::swap_stacks(const Vector2i position, GridInventory *other_in
 		return false;
 	if (stack == other_stack)
 		return false;
-	Vector2i real_other_position = other_inventory->get_stack_position(other_stack);
-	if (!_size_check(stack, other_stack))
+	if (!_size_check(stack, other_inventory, other_stack))
 		return false;
-	int stack_index = stacks.find(stack);
+	int stack_index = _get_stack_index(stack);
 	if (stack_index == -1)
 		return false;
+	int other_stack_index = other_inventory->_get_stack_index(other_stack);
+	if (other_stack_index == -1)
+		return false;
 
 	String stack_item_id = stack->get_item_id();
 	String other_stack_item_id = other_stack->get_item_id();
@@ -350,12 +649,10 @@ bool GridInventory::swap_stacks(const Vector2i position, GridInventory *other_in
 	int other_stack_amount = other_stack->get_amount();
 	Dictionary stack_properties = stack->get_properties();
 	Dictionary other_stack_properties = other_stack->get_properties();
-	bool stack_rotation = false;
-	bool other_stack_rotation = false;
-
-	int other_stack_index = other_inventory->stacks.find(other_stack);
-	if (other_stack_index == -1)
-		return false;
+	Vector2i real_position = get_stack_position(stack);
+	Vector2i real_other_position = other_inventory->get_stack_position(other_stack);
+	bool stack_rotation = is_stack_rotated(stack);
+	bool other_stack_rotation = other_inventory->is_stack_rotated(other_stack);
 
 	if (!_can_swap_to_inventory(this, other_stack_item_id, other_stack_amount, other_stack_properties))
 		return false;
@@ -363,81 +660,400 @@ bool GridInventory::swap_stacks(const Vector2i position, GridInventory *other_in
 	if (!_can_swap_to_inventory(other_inventory, stack_item_id, stack_amount, stack_properties))
 		return false;
 
-	if (!_can_add_on_position(position, other_stack_item_id, other_stack_amount, other_stack_properties, other_stack_rotation))
+	if (!_can_add_on_position(real_position, other_stack_item_id, other_stack_amount, other_stack_properties, other_stack_rotation))
 		return false;
 
 	if (!other_inventory->_can_add_on_position(real_other_position, stack_item_id, stack_amount, stack_properties, stack_rotation))
 		return false;
 
-	remove_at(stack_index, stack_item_id, stack_amount);
-	other_inventory->remove_at(other_stack_index, other_stack_item_id, other_stack_amount);
+	// Both stacks cover the same cells, so the occupancy bitmaps stay as they are
+	// and only the slots and the quad tree entries change hands.
+	if (other_inventory == this) {
+		GridSlot &slot = slots[_get_slot(stack)];
+		GridSlot &other_slot = slots[_get_slot(other_stack)];
+		SWAP(slot.position, other_slot.position);
+		SWAP(slot.rect, other_slot.rect);
+		quad_tree->move(stack, slot.rect);
+		quad_tree->move(other_stack, other_slot.rect);
+		_record_move_op(stack_index);
+		_record_move_op(other_stack_index);
+		_flag_contents_changed = true;
+		return true;
+	}
+
+	if (!_can_replace_stack(stack_index, other_stack_item_id, other_stack_amount, other_stack_properties))
+		return false;
 
-	add_at_position(position, other_stack_item_id, other_stack_amount, other_stack_properties);
-	other_inventory->add_at_position(real_other_position, stack_item_id, stack_amount, stack_properties);
+	if (!other_inventory->_can_replace_stack(other_stack_index, stack_item_id, stack_amount, stack_properties))
+		return false;
 
+	int old_amount = amount();
+	int other_old_amount = other_inventory->amount();
+	_replace_slot_stack(stack_index, other_stack, other_stack_rotation);
+	other_inventory->_replace_slot_stack(other_stack_index, stack, stack_rotation);
+	emit_signal("updated_stack", stack_index);
+	other_inventory->emit_signal("updated_stack", other_stack_index);
+	_call_events(old_amount);
+	other_inventory->_call_events(other_old_amount);
 	return true;
 }
 
-bool GridInventory::rect_free(const Rect2i &rect, const Ref<ItemStack> &exception) const {
-	if (rect.position.x < 0 || rect.position.y < 0 || rect.size.x < 1 || rect.size.y < 1)
-		return false;
-	if (rect.position.x + rect.size.x > size.x)
-		return false;
-	if (rect.position.y + rect.size.y > size.y)
-		return false;
+void GridInventory::_replace_slot_stack(const int stack_index, const Ref<ItemStack> &new_stack, const bool is_rotated) {
+	Ref<ItemStack> old_stack = stacks[stack_index];
+	int32_t slot_id = _get_slot(old_stack);
+	ERR_FAIL_COND_MSG(slot_id == -1, "The stack has no grid slot.");
+	GridSlot &slot = slots[slot_id];
+	slot_ids.erase(old_stack->get_instance_id());
+	slot_ids.insert(new_stack->get_instance_id(), slot_id);
+	bool was_rotated = slot.is_rotated;
+	slot.is_rotated = is_rotated;
+	slot.is_placed_rotated = is_rotated;
+	quad_tree->remove(old_stack);
+	quad_tree->add(slot.rect, new_stack);
+	stacks[stack_index] = new_stack;
+	_record_stack_op(OP_SET, stack_index);
+	if (was_rotated != is_rotated && _is_recording_ops())
+		_begin_op(OP_ROTATE, stack_index).put_u8(is_rotated);
+	_flag_contents_changed = true;
+}
 
-	ERR_FAIL_NULL_V_MSG(quad_tree, 0, "'quad_tree' is null.");
-	return quad_tree->get_first(rect, exception) == nullptr;
+bool GridInventory::rect_free(const Rect2i &rect, const Ref<ItemStack> &exception) const {
+	return _shape_free(GridShape(rect), exception);
 }
 
 Vector2i GridInventory::find_free_place(const Vector2i item_size, const String item_id, const int amount, const Dictionary properties, const bool is_rotated, const Ref<ItemStack> &exception) const {
-	Vector2i result = Vector2i(-1, -1);
+	_ensure_loaded();
 	Vector2i final_size = item_size;
 	if (is_rotated) {
 		final_size = Vector2i(final_size.y, final_size.x);
 	}
-	for (size_t y = 0; y < (size.y - (final_size.y - 1)); y++) {
-		for (size_t x = 0; x < (size.x - (final_size.x - 1)); x++) {
-			Rect2i rect = Rect2i(Vector2i(x, y), final_size);
-			if (rect_free(rect, exception) && _can_add_on_position(Vector2i(x, y), item_id, amount, properties, is_rotated)) {
-				return Vector2i(x, y);
-			}
-		}
+	return _find_free_place_on(occupancy, final_size, item_id, amount, properties, is_rotated, _get_placed_shape(exception));
+}
+
+Vector2i GridInventory::_find_free_place_on(const GridOccupancy &grid, const Vector2i &final_size, const String &item_id, const int amount, const Dictionary &properties, const bool is_rotated, const GridShape &exception) const {
+	// The occupancy only yields free origins, so grid constraints are asked
+	// about those and never about blocked cells.
+	GridShape shape = _get_item_shape(item_id, Rect2i(Vector2i(0, 0), final_size), is_rotated);
+	GridOccupancy scratch;
+	const GridOccupancy &search = _get_search_cells(grid, item_id, scratch);
+	Vector2i position = search.find_free_shape(shape, exception);
+	while (position != Vector2i(-1, -1)) {
+		if (_can_add_on_position(position, item_id, amount, properties, is_rotated))
+			return position;
+		position = search.find_free_shape(shape, exception, position + Vector2i(1, 0));
 	}
+	return Vector2i(-1, -1);
+}
+
+PackedByteArray GridInventory::get_placement_mask(const Vector2i item_size, const bool is_rotated, const String &item_id, const int amount, const Dictionary &properties, const Ref<ItemStack> &exception) const {
+	_ensure_loaded();
+	PackedByteArray mask = PackedByteArray();
+	mask.resize(size.x * size.y);
+	Vector2i final_size = is_rotated ? Vector2i(item_size.y, item_size.x) : item_size;
+	_fill_placement_mask(mask.ptrw(), Rect2i(Vector2i(0, 0), size), final_size, item_id, amount, properties, is_rotated, exception);
+	return mask;
+}
+
+PackedByteArray GridInventory::update_placement_mask(const PackedByteArray &mask, const Rect2i &changed_rect, const Vector2i item_size, const bool is_rotated, const String &item_id, const int amount, const Dictionary &properties, const Ref<ItemStack> &exception) const {
+	_ensure_loaded();
+	if (mask.size() != size.x * size.y)
+		return get_placement_mask(item_size, is_rotated, item_id, amount, properties, exception);
+	PackedByteArray result = mask;
+	// Only origins whose footprint reaches into the changed cells can flip.
+	Vector2i final_size = is_rotated ? Vector2i(item_size.y, item_size.x) : item_size;
+	Rect2i area = Rect2i(changed_rect.position - final_size + Vector2i(1, 1), changed_rect.size + final_size - Vector2i(1, 1));
+	_fill_placement_mask(result.ptrw(), area, final_size, item_id, amount, properties, is_rotated, exception);
 	return result;
 }
 
-bool GridInventory::sort() {
-	// TypedArray<ItemStack> stack_array;
-	// for (size_t i = 0; i < stacks.size(); i++) {
-	// 	Ref<ItemStack> stack = stacks[i];
-	// 	stack_array.append(stack);
-	// 	stack_array.sort_custom(callable_mp(this, &GridInventory::_compare_stacks));
-	// }
+void GridInventory::_fill_placement_mask(uint8_t *mask, const Rect2i &area, const Vector2i &final_size, const String &item_id, const int amount, const Dictionary &properties, const bool is_rotated, const Ref<ItemStack> &exception) const {
+	Rect2i clipped = area.intersection(Rect2i(Vector2i(0, 0), size));
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return;
+	int from_y = clipped.position.y;
+	LocalVector<uint64_t> origins;
+	GridShape shape = GridShape(Rect2i(Vector2i(0, 0), final_size), item_id.is_empty() ? nullptr : _get_shape_rows(item_id, is_rotated));
+	GridOccupancy scratch;
+	_get_search_cells(occupancy, item_id, scratch).get_free_origins(shape, _get_placed_shape(exception), from_y, from_y + clipped.size.y, origins);
+	int words_per_row = occupancy.get_words_per_row();
+	for (int y = from_y; y < from_y + clipped.size.y; y++) {
+		const uint64_t *row = origins.ptr() + (y - from_y) * words_per_row;
+		for (int x = clipped.position.x; x < clipped.position.x + clipped.size.x; x++) {
+			bool valid = (row[x / 64] >> (x % 64)) & 1;
+			// Grid constraints are only asked about origins that are free.
+			if (valid && !item_id.is_empty())
+				valid = _can_add_on_position(Vector2i(x, y), item_id, amount, properties, is_rotated);
+			mask[y * size.x + x] = valid;
+		}
+	}
+}
 
-	// for (size_t i = 0; i < stack_array.size(); i++) {
-	// 	Ref<ItemStack> stack = stack_array[i];
-	// 	_move_stack_to_unsafe(stack, -get_stack_size(stack));
-	// }
+namespace {
+
+struct PackEntry {
+	Ref<ItemStack> stack;
+	int32_t index = 0;
+	Vector2i item_size;
+	int64_t primary = 0;
+	int64_t secondary = 0;
+	String item_id;
+	int amount = 0;
+	Dictionary properties;
+
+	bool operator<(const PackEntry &other) const {
+		if (primary != other.primary)
+			return primary > other.primary;
+		if (secondary != other.secondary)
+			return secondary > other.secondary;
+		if (item_id != other.item_id)
+			return item_id < other.item_id;
+		return index < other.index;
+	}
+};
+
+void set_pack_keys(PackEntry &entry, const int sort_key) {
+	int64_t area = int64_t(entry.item_size.x) * entry.item_size.y;
+	int64_t longest = MAX(entry.item_size.x, entry.item_size.y);
+	switch (sort_key) {
+		case GridInventory::SORT_BY_HEIGHT:
+			entry.primary = entry.item_size.y;
+			entry.secondary = area;
+			break;
+		case GridInventory::SORT_BY_WIDTH:
+			entry.primary = entry.item_size.x;
+			entry.secondary = area;
+			break;
+		case GridInventory::SORT_BY_ITEM_ID:
+			break;
+		default:
+			entry.primary = area;
+			entry.secondary = longest;
+			break;
+	}
+}
 
-	// for (size_t i = 0; i < stack_array.size(); i++) {
-	// 	Ref<ItemStack> stack = stack_array[i];
-	// 	Vector2i free_place = find_free_place(get_stack_size(stack), stack->get_item_id(), stack->get_amount(), stack->get_properties());
-	// 	if (free_place == Vector2i(-1, -1))
-	// 		return false;
-	// 	move_stack_to(stack, free_place);
-	// }
+} // namespace
+
+bool GridInventory::_find_packed_place(const GridOccupancy &grid, const String &item_id, const int amount, const Dictionary &properties, const Vector2i &item_size, Vector2i &position, bool &is_rotated) const {
+	// Both orientations are tried and the one landing higher up, then further
+	// left, wins.
+	position = _find_free_place_on(grid, item_size, item_id, amount, properties, false);
+	is_rotated = false;
+	if (item_size.x != item_size.y) {
+		Vector2i rotated_position = _find_free_place_on(grid, Vector2i(item_size.y, item_size.x), item_id, amount, properties, true);
+		if (rotated_position != Vector2i(-1, -1) && (position == Vector2i(-1, -1) || rotated_position.y < position.y || (rotated_position.y == position.y && rotated_position.x < position.x))) {
+			position = rotated_position;
+			is_rotated = true;
+		}
+	}
+	return position != Vector2i(-1, -1);
+}
+
+bool GridInventory::sort(const int64_t time_budget_usec, const int sort_key) {
+	_ensure_loaded();
+	ERR_FAIL_NULL_V_MSG(quad_tree, false, "'quad_tree' is null.");
+	ERR_FAIL_NULL_V_MSG(get_database(), false, "'database' is null.");
+	uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	LocalVector<PackEntry> entries;
+	for (int64_t i = 0; i < stacks.size(); i++) {
+		Ref<ItemStack> stack = stacks[i];
+		if (stack == nullptr)
+			continue;
+		Ref<ItemDefinition> definition = get_database()->get_item(stack->get_item_id());
+		ERR_FAIL_NULL_V_MSG(definition, false, "'definition' is null.");
+		ERR_FAIL_COND_V_MSG(_get_slot(stack) == -1, false, "The stack has no grid slot.");
+		PackEntry entry;
+		entry.stack = stack;
+		entry.index = i;
+		entry.item_size = definition->get_size();
+		entry.item_id = stack->get_item_id();
+		entry.amount = stack->get_amount();
+		entry.properties = stack->get_properties();
+		set_pack_keys(entry, sort_key);
+		entries.push_back(entry);
+	}
+	entries.sort();
+
+	// Stacks are packed bottom-left (first free row, then first free column)
+	// into a scratch grid, so running out of space or time leaves the
+	// inventory untouched.
+	GridOccupancy packed;
+	packed.resize(size);
+	LocalVector<Vector2i> positions;
+	LocalVector<uint8_t> rotations;
+	positions.resize(entries.size());
+	rotations.resize(entries.size());
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		if (time_budget_usec > 0 && Time::get_singleton()->get_ticks_usec() - start_usec > uint64_t(time_budget_usec))
+			return false;
+		const PackEntry &entry = entries[i];
+		Vector2i position;
+		bool is_rotated = false;
+		if (!_find_packed_place(packed, entry.item_id, entry.amount, entry.properties, entry.item_size, position, is_rotated))
+			return false;
+		Vector2i item_size = is_rotated ? Vector2i(entry.item_size.y, entry.item_size.x) : entry.item_size;
+		packed.fill_shape(_get_item_shape(entry.item_id, Rect2i(position, item_size), is_rotated));
+		positions[i] = position;
+		rotations[i] = is_rotated;
+	}
+
+	bool changed = false;
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		GridSlot &slot = slots[_get_slot(entries[i].stack)];
+		if (slot.position == positions[i] && slot.is_rotated == bool(rotations[i]))
+			continue;
+		slot.position = positions[i];
+		slot.is_rotated = rotations[i];
+		changed = true;
+		if (_is_recording_ops()) {
+			_begin_op(OP_ROTATE, entries[i].index).put_u8(rotations[i]);
+			_record_move_op(entries[i].index);
+		}
+	}
+	if (changed) {
+		_refresh_quad_tree();
+		_flag_contents_changed = true;
+	}
 	return true;
 }
 
+Array GridInventory::add_batch(const Array &items) {
+	_ensure_loaded();
+	ERR_FAIL_NULL_V_MSG(quad_tree, items, "'quad_tree' is null.");
+	ERR_FAIL_NULL_V_MSG(get_database(), items, "'database' is null.");
+	int old_amount = amount();
+
+	// Existing stacks are topped up first, as add() does, and whatever is
+	// left is cut into new stacks that are placed largest first.
+	LocalVector<int> remaining;
+	LocalVector<PackEntry> entries;
+	remaining.resize(items.size());
+	for (int64_t k = 0; k < items.size(); k++) {
+		Dictionary item = items[k];
+		String item_id = item.get("item_id", "");
+		int amount = item.get("amount", 1);
+		Dictionary properties = item.get("properties", Dictionary());
+		remaining[k] = MAX(amount, 0);
+		Ref<ItemDefinition> definition = get_database()->get_item(item_id);
+		if (definition == nullptr || amount <= 0)
+			continue;
+		for (int64_t i = 0; i < stacks.size() && amount > 0; i++) {
+			amount = _add_to_stack(i, item_id, amount, properties);
+		}
+		remaining[k] = amount;
+		int max_stack = _get_max_stack_for_stack(item_id, amount, properties);
+		if (max_stack <= 0)
+			continue;
+		while (amount > 0) {
+			PackEntry entry;
+			entry.index = k;
+			entry.item_size = definition->get_size();
+			entry.item_id = item_id;
+			entry.amount = MIN(amount, max_stack);
+			entry.properties = properties;
+			set_pack_keys(entry, SORT_BY_AREA);
+			entries.push_back(entry);
+			amount -= entry.amount;
+		}
+	}
+	entries.sort();
+
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		const PackEntry &entry = entries[i];
+		if (!Inventory::can_add_new_stack(entry.item_id, entry.amount, entry.properties))
+			continue;
+		int amount_to_add = MIN(entry.amount, _get_amount_to_add_from_constraints(entry.item_id, entry.amount, entry.properties));
+		if (amount_to_add <= 0)
+			continue;
+		Vector2i position;
+		bool is_rotated = false;
+		if (!_find_packed_place(occupancy, entry.item_id, amount_to_add, entry.properties, entry.item_size, position, is_rotated))
+			continue;
+		Ref<ItemStack> stack = memnew(ItemStack());
+		stack->restore(entry.item_id, amount_to_add, entry.properties);
+		stacks.append(stack);
+		int stack_index = stacks.size() - 1;
+		_record_stack_op(OP_INSERT, stack_index);
+		_create_slot(stack, stack_index, position, is_rotated);
+		if (is_rotated && _is_recording_ops())
+			_begin_op(OP_ROTATE, stack_index).put_u8(is_rotated);
+		_record_move_op(stack_index);
+		_place_stack_unsafe(stack, Rect2i(position, is_rotated ? Vector2i(entry.item_size.y, entry.item_size.x) : entry.item_size));
+		remaining[entry.index] -= amount_to_add;
+		emit_signal("stack_added", stack_index);
+	}
+
+	Array leftovers = Array();
+	for (int64_t k = 0; k < items.size(); k++) {
+		if (remaining[k] <= 0)
+			continue;
+		Dictionary item = items[k];
+		Dictionary leftover = Dictionary();
+		leftover["item_id"] = item.get("item_id", "");
+		leftover["amount"] = remaining[k];
+		leftover["properties"] = item.get("properties", Dictionary());
+		leftovers.append(leftover);
+	}
+	_call_events(old_amount);
+	return leftovers;
+}
+
+int GridInventory::defragment() {
+	_ensure_loaded();
+	int removed = 0;
+	if (_merge_stacks(removed))
+		_flag_contents_changed = true;
+	// Merging leaves holes where the emptied stacks were, so the survivors
+	// are packed again; if they no longer fit, the merged layout is kept.
+	sort();
+	return removed;
+}
+
 Dictionary GridInventory::serialize() const {
+	if (has_pending_data())
+		return Inventory::serialize();
 	Dictionary data = Inventory::serialize();
-	data["stack_positions"] = stack_positions.duplicate();
-	data["stack_rotations"] = stack_rotations.duplicate();
+	data["stack_positions"] = get_stack_positions().duplicate();
+	data["stack_rotations"] = get_stack_rotations().duplicate();
 	return data;
 }
 
+void GridInventory::_fill_snapshot(InventorySnapshot *snapshot) const {
+	Inventory::_fill_snapshot(snapshot);
+	snapshot->begin_grid();
+	if (_slots_dirty) {
+		for (int64_t i = 0; i < stacks.size(); i++) {
+			Vector2i position = i < stack_positions.size() ? Vector2i(stack_positions[i]) : Vector2i(0, 0);
+			snapshot->set_grid_stack(i, position, i < stack_rotations.size() && bool(stack_rotations[i]));
+		}
+		return;
+	}
+	for (int64_t i = 0; i < stacks.size(); i++) {
+		int32_t slot_id = _get_slot(stacks[i]);
+		if (slot_id != -1)
+			snapshot->set_grid_stack(i, slots[slot_id].position, slots[slot_id].is_rotated);
+	}
+}
+
+void GridInventory::_restore_snapshot(const InventorySnapshot *snapshot) {
+	Inventory::_restore_snapshot(snapshot);
+	int stack_count = snapshot->get_stack_count();
+	stack_positions.resize(stack_count);
+	stack_rotations.resize(stack_count);
+	for (int i = 0; i < stack_count; i++) {
+		stack_positions[i] = snapshot->get_position(i);
+		stack_rotations[i] = snapshot->is_rotated(i);
+	}
+	_slots_dirty = true;
+	_refresh_quad_tree();
+}
+
 void GridInventory::deserialize(const Dictionary data) {
+	ERR_FAIL_COND_MSG(!data.has("items"), "Data to deserialize is invalid: Does not contain the 'items' field");
+	_record_reset_op(data);
+	if (_defer_deserialize(data))
+		return;
 	Array stack_positions_var = data["stack_positions"];
 	Array stack_rotations_var = data["stack_rotations"];
 
@@ -450,19 +1066,57 @@ void GridInventory::deserialize(const Dictionary data) {
 	for (size_t i = 0; i < stack_rotations_var.size(); i++) {
 		stack_rotations.append(stack_rotations_var[i]);
 	}
+	_slots_dirty = true;
 
-	Inventory::deserialize(data);
-	for (size_t i = 0; i < stack_positions.size(); i++) {
-		Ref<ItemStack> stack = stacks[i];
-		quad_tree->add(get_stack_rect(stack), stack);
-	}
+	_deserialize_stacks(data);
+	_refresh_quad_tree();
 }
 
 bool GridInventory::can_add_new_stack(const String &item_id, const int &amount, const Dictionary &properties) const {
-	return (has_space_for(item_id, amount, properties, false) || has_space_for(item_id, amount, properties, true)) && Inventory::can_add_new_stack(item_id, amount, properties);
+	_ensure_loaded();
+	Vector2i position;
+	bool is_rotated;
+	return _find_placement(item_id, amount, properties, position, is_rotated) && Inventory::can_add_new_stack(item_id, amount, properties);
+}
+
+bool GridInventory::_find_placement(const String &item_id, const int amount, const Dictionary &properties, Vector2i &position, bool &is_rotated) const {
+	// can_add_new_stack and the following on_insert_stack ask for the same
+	// item, so the search is only repeated if the occupancy or a constraint mask
+	// changed in between. Script checks can change at any time, so a cached
+	// spot is asked again before it is reused.
+	if (_placement_cached && _placement_version == occupancy.get_version() && _placement_amount == amount && _placement_item_id == item_id && _placement_properties == properties && _constraint_versions_match(_placement_constraint_versions)) {
+		if (_can_add_on_position(_placement_position, item_id, amount, properties, _placement_rotated)) {
+			position = _placement_position;
+			is_rotated = _placement_rotated;
+			return true;
+		}
+		_placement_cached = false;
+	}
+	ERR_FAIL_NULL_V_MSG(get_database(), false, "'database' is null.");
+	Ref<ItemDefinition> definition = get_database()->get_item(item_id);
+	ERR_FAIL_NULL_V_MSG(definition, false, "'definition' is null.");
+	is_rotated = false;
+	position = find_free_place(definition->get_size(), item_id, amount, properties, false);
+	if (position == Vector2i(-1, -1)) {
+		is_rotated = true;
+		position = find_free_place(definition->get_size(), item_id, amount, properties, true);
+	}
+	// Failures are not kept, a later call may succeed without any grid change.
+	_placement_cached = position != Vector2i(-1, -1);
+	if (!_placement_cached)
+		return false;
+	_placement_version = occupancy.get_version();
+	_placement_item_id = item_id;
+	_placement_amount = amount;
+	_placement_properties = properties;
+	_placement_position = position;
+	_placement_rotated = is_rotated;
+	_get_constraint_versions(_placement_constraint_versions);
+	return true;
 }
 
 bool GridInventory::has_space_for(const String &item_id, const int amount, const Dictionary &properties, const bool is_rotated) const {
+	_ensure_loaded();
 	Ref<ItemDefinition> definition = get_database()->get_item(item_id);
 	ERR_FAIL_NULL_V_MSG(definition, false, "'definition' is null.");
 
@@ -475,41 +1129,69 @@ bool GridInventory::has_space_for(const String &item_id, const int amount, const
 }
 
 void GridInventory::on_insert_stack(const int stack_index) {
+	// The placement from transfer_stack_to is one-shot, so take it before any
+	// early return can leave it set for a later insert.
+	bool has_insert_placement = _has_insert_placement;
+	_has_insert_placement = false;
 	Ref<ItemStack> stack = stacks[stack_index];
 	if (stack == nullptr)
 		return;
+	if (_applying_ops) {
+		// The placement follows as move/rotate ops in the same stream.
+		_create_slot(stack, stack_index, Vector2i(0, 0), false);
+		_reindex_slots(stack_index + 1);
+		return;
+	}
 	ERR_FAIL_NULL_MSG(quad_tree, "'quad_tree' is null.");
 	ERR_FAIL_NULL_MSG(get_database(), "'database' is null.");
 	Ref<ItemDefinition> definition = get_database()->get_item(stack->get_item_id());
 	ERR_FAIL_NULL_MSG(definition, "'definition' is null.");
 	bool is_rotated = false;
 	Vector2i position;
-	position = find_free_place(definition->get_size(), stack->get_item_id(), stack->get_amount(), stack->get_properties(), is_rotated);
-	if (position == Vector2i(-1, -1)) {
-		is_rotated = true;
-		position = find_free_place(definition->get_size(), stack->get_item_id(), stack->get_amount(), stack->get_properties(), true);
+	if (has_insert_placement) {
+		// The caller already checked this spot, see transfer_stack_to.
+		position = _insert_position;
+		is_rotated = _insert_rotated;
+	} else {
+		_find_placement(stack->get_item_id(), stack->get_amount(), stack->get_properties(), position, is_rotated);
 	}
-	stack_positions.insert(stack_index, position);
-	stack_rotations.insert(stack_index, is_rotated);
+	_create_slot(stack, stack_index, position, is_rotated);
+	_reindex_slots(stack_index + 1);
+	if (is_rotated && _is_recording_ops())
+		_begin_op(OP_ROTATE, stack_index).put_u8(is_rotated);
+	_record_move_op(stack_index);
 	Vector2i size;
 	if (is_rotated) {
 		size = definition->get_rotated_size();
 	} else {
 		size = definition->get_size();
 	}
-	quad_tree->add(Rect2i(position, size), stack);
+	_place_stack_unsafe(stack, Rect2i(position, size));
 }
 
 void GridInventory::on_removed_stack(const Ref<ItemStack> stack, const int stack_index) {
-	stack_positions.remove_at(stack_index);
-	stack_rotations.remove_at(stack_index);
+	_reindex_slots(stack_index);
 	if (stack == nullptr)
 		return;
-	quad_tree->remove(stack);
+	_unplace_stack_unsafe(stack);
+	_free_slot(stack);
 }
 
-bool GridInventory::_size_check(const Ref<ItemStack> stack1, const Ref<ItemStack> stack2) {
-	return get_stack_size(stack1) == get_stack_size(stack2);
+bool GridInventory::_size_check(const Ref<ItemStack> stack1, const GridInventory *other_inventory, const Ref<ItemStack> stack2) const {
+	Vector2i stack_size = get_stack_size(stack1);
+	if (stack_size != other_inventory->get_stack_size(stack2))
+		return false;
+	const uint64_t *rows1 = _get_shape_rows(stack1->get_item_id(), is_stack_rotated(stack1));
+	const uint64_t *rows2 = other_inventory->_get_shape_rows(stack2->get_item_id(), other_inventory->is_stack_rotated(stack2));
+	if (rows1 == rows2)
+		return true;
+	if (rows1 == nullptr || rows2 == nullptr)
+		return false;
+	for (int y = 0; y < stack_size.y; y++) {
+		if (rows1[y] != rows2[y])
+			return false;
+	}
+	return true;
 }
 
 bool GridInventory::_is_sorted() {
@@ -529,12 +1211,68 @@ bool GridInventory::_is_sorted() {
 }
 
 void GridInventory::_move_stack_to_unsafe(const Ref<ItemStack> &stack, const Vector2i &position) {
-	int stack_index = stacks.find(stack);
-	if (stack_index == -1)
+	int32_t slot_id = _get_slot(stack);
+	if (slot_id == -1)
 		return;
-	stack_positions[stack_index] = position;
-	quad_tree->remove(stack);
-	quad_tree->add(get_stack_rect(stack), stack);
+	GridSlot &slot = slots[slot_id];
+	GridShape old_shape = _get_placed_shape(stack);
+	slot.position = position;
+	Rect2i new_rect = _make_stack_rect(stack, position, slot.is_rotated);
+	if (!slot.is_placed) {
+		_place_stack_unsafe(stack, new_rect);
+	} else {
+		quad_tree->move(stack, new_rect);
+		slot.rect = new_rect;
+		slot.is_placed_rotated = slot.is_rotated;
+		_clear_occupancy(old_shape);
+		occupancy.fill_shape(_get_placed_shape(stack));
+	}
+	_record_move_op(slot.stack_index);
+}
+
+void GridInventory::_record_move_op(const int stack_index) {
+	if (!_is_recording_ops())
+		return;
+	Vector2i position = get_stack_position(stacks[stack_index]);
+	ByteWriter &writer = _begin_op(OP_MOVE, stack_index);
+	writer.put_zigzag(position.x);
+	writer.put_zigzag(position.y);
+}
+
+bool GridInventory::_apply_op(const int op, const int stack_index, ByteReader &reader) {
+	switch (op) {
+		case OP_SET: {
+			// The new content may have another shape, so lift the old one first.
+			ERR_FAIL_INDEX_V(stack_index, stacks.size(), false);
+			Ref<ItemStack> stack = stacks[stack_index];
+			int32_t slot_id = _get_slot(stack);
+			bool was_placed = slot_id != -1 && slots[slot_id].is_placed;
+			if (was_placed)
+				_unplace_stack_unsafe(stack);
+			bool applied = Inventory::_apply_op(op, stack_index, reader);
+			if (was_placed)
+				_place_stack_unsafe(stack, _make_stack_rect(stack, slots[slot_id].position, slots[slot_id].is_rotated));
+			return applied;
+		}
+		case OP_MOVE: {
+			ERR_FAIL_INDEX_V(stack_index, stacks.size(), false);
+			int x = reader.get_zigzag();
+			int y = reader.get_zigzag();
+			_move_stack_to_unsafe(stacks[stack_index], Vector2i(x, y));
+			return true;
+		}
+		case OP_ROTATE: {
+			ERR_FAIL_INDEX_V(stack_index, stacks.size(), false);
+			Ref<ItemStack> stack = stacks[stack_index];
+			int32_t slot_id = _get_slot(stack);
+			ERR_FAIL_COND_V(slot_id == -1, false);
+			slots[slot_id].is_rotated = reader.get_u8() != 0;
+			_move_stack_to_unsafe(stack, slots[slot_id].position);
+			return true;
+		}
+		default:
+			return Inventory::_apply_op(op, stack_index, reader);
+	}
 }
 
 bool GridInventory::_compare_stacks(const Ref<ItemStack> &stack1, const Ref<ItemStack> &stack2) const {
@@ -548,7 +1286,114 @@ void GridInventory::_sort_if_needed() {
 		sort();
 }
 
+void GridInventory::_get_constraint_versions(LocalVector<uint64_t> &versions) const {
+	// Zero stands for an empty constraint slot.
+	versions.resize(grid_constraints.size());
+	for (int64_t i = 0; i < grid_constraints.size(); i++) {
+		Ref<GridInventoryConstraint> grid_constraint = grid_constraints[i];
+		versions[i] = grid_constraint == nullptr ? 0 : grid_constraint->get_cells_version() + 1;
+	}
+}
+
+bool GridInventory::_constraint_versions_match(const LocalVector<uint64_t> &versions) const {
+	if (versions.size() != uint32_t(grid_constraints.size()))
+		return false;
+	for (int64_t i = 0; i < grid_constraints.size(); i++) {
+		Ref<GridInventoryConstraint> grid_constraint = grid_constraints[i];
+		if (versions[i] != (grid_constraint == nullptr ? 0 : grid_constraint->get_cells_version() + 1))
+			return false;
+	}
+	return true;
+}
+
+void GridInventory::_validate_blocked_cells() const {
+	// Blocked cells are rebuilt when a constraint or the size changes.
+	if (_blocked_cells_size == size && _constraint_versions_match(_blocked_cells_versions))
+		return;
+	_blocked_cells_keys.clear();
+	_blocked_cells.clear();
+	_blocked_cells_size = size;
+	_get_constraint_versions(_blocked_cells_versions);
+	_merged_cells_valid = false;
+}
+
+String GridInventory::_get_blocked_cells_key(const String &item_id) const {
+	// Items restricted by the same masked constraints share one bitmap, keyed
+	// by the constraint indices. Items no mask applies to get an empty key and
+	// no bitmap.
+	_validate_blocked_cells();
+	const String *cached_key = _blocked_cells_keys.getptr(item_id);
+	if (cached_key != nullptr)
+		return *cached_key;
+
+	String key = "";
+	Ref<ItemDefinition> definition = get_database() == nullptr ? nullptr : get_database()->get_item(item_id);
+	for (int64_t i = 0; i < grid_constraints.size(); i++) {
+		Ref<GridInventoryConstraint> grid_constraint = grid_constraints[i];
+		if (grid_constraint != nullptr && grid_constraint->has_cell_mask() && grid_constraint->applies_to(definition))
+			key += String::num_int64(i) + ",";
+	}
+	_blocked_cells_keys.insert(item_id, key);
+	if (key.is_empty() || _blocked_cells.has(key))
+		return key;
+
+	GridOccupancy blocked;
+	blocked.resize(size);
+	for (int64_t i = 0; i < grid_constraints.size(); i++) {
+		Ref<GridInventoryConstraint> grid_constraint = grid_constraints[i];
+		if (grid_constraint == nullptr || !grid_constraint->has_cell_mask() || !grid_constraint->applies_to(definition))
+			continue;
+		Vector2i mask_size = grid_constraint->get_allowed_cells_size();
+		for (int y = 0; y < MIN(mask_size.y, size.y); y++) {
+			for (int x = 0; x < MIN(mask_size.x, size.x); x++) {
+				if (!grid_constraint->is_cell_allowed(Vector2i(x, y)))
+					blocked.fill(Rect2i(x, y, 1, 1));
+			}
+		}
+	}
+	_blocked_cells.insert(key, blocked);
+	return key;
+}
+
+const GridOccupancy *GridInventory::_get_blocked_cells(const String &item_id) const {
+	// Cells ruled out for the item by the static masks of the grid constraints.
+	String key = _get_blocked_cells_key(item_id);
+	if (key.is_empty())
+		return nullptr;
+	return _blocked_cells.getptr(key);
+}
+
+const GridOccupancy &GridInventory::_get_search_cells(const GridOccupancy &grid, const String &item_id, GridOccupancy &scratch) const {
+	// The grid with the item's blocked cells merged in. Only one merged copy
+	// of the live occupancy is kept, for the last constraint set and
+	// occupancy version asked for; other grids are merged into 'scratch'.
+	const GridOccupancy *blocked = item_id.is_empty() ? nullptr : _get_blocked_cells(item_id);
+	if (blocked == nullptr)
+		return grid;
+	if (&grid != &occupancy) {
+		scratch = grid;
+		scratch.merge(*blocked);
+		return scratch;
+	}
+	String key = _get_blocked_cells_key(item_id);
+	if (!_merged_cells_valid || _merged_cells_version != occupancy.get_version() || _merged_cells_key != key) {
+		_merged_cells = occupancy;
+		_merged_cells.merge(*blocked);
+		_merged_cells_key = key;
+		_merged_cells_version = occupancy.get_version();
+		_merged_cells_valid = true;
+	}
+	return _merged_cells;
+}
+
 bool GridInventory::_can_add_on_position(const Vector2i position, const String item_id, const int amount, const Dictionary properties, const bool is_rotated) const {
+	const GridOccupancy *blocked = _get_blocked_cells(item_id);
+	if (blocked != nullptr && get_database() != nullptr) {
+		Ref<ItemDefinition> definition = get_database()->get_item(item_id);
+		Vector2i item_size = definition == nullptr ? Vector2i(1, 1) : (is_rotated ? definition->get_rotated_size() : definition->get_size());
+		if (!blocked->is_shape_free(_get_item_shape(item_id, Rect2i(position, item_size), is_rotated)))
+			return false;
+	}
 	for (size_t i = 0; i < grid_constraints.size(); i++) {
 		Ref<GridInventoryConstraint> grid_constraint = grid_constraints[i];
 		if (grid_constraint != nullptr && !grid_constraint->can_add_on_position(this, position, item_id, amount, properties, is_rotated)) {
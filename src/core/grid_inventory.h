@@ -3,8 +3,11 @@
 
 // #include "base/node_inventories.h"
 #include "constraints/grid_inventory_constraint.h"
+#include "core/grid_occupancy.h"
 #include "core/inventory.h"
 #include "core/quad_tree.h"
+#include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
 
 using namespace godot;
 
@@ -12,25 +15,94 @@ class GridInventory : public Inventory {
 	GDCLASS(GridInventory, Inventory);
 
 private:
+	struct GridSlot {
+		Vector2i position;
+		bool is_rotated = false;
+		bool is_placed = false;
+		bool is_placed_rotated = false;
+		Rect2i rect;
+		int32_t stack_index = -1;
+		int32_t next_free = -1;
+	};
 	Vector2i _swap_position = Vector2i(0, 0);
 	Ref<QuadTree> quad_tree;
 	Vector2i size = Vector2i(8, 8);
 	TypedArray<GridInventoryConstraint> grid_constraints;
 	TypedArray<Vector2i> stack_positions;
 	TypedArray<bool> stack_rotations;
+	bool _slots_dirty = true;
+	LocalVector<GridSlot> slots;
+	int32_t _first_free_slot = -1;
+	HashMap<uint64_t, int32_t> slot_ids;
+	GridOccupancy occupancy;
+	mutable HashMap<String, String> _blocked_cells_keys;
+	mutable HashMap<String, GridOccupancy> _blocked_cells;
+	mutable LocalVector<uint64_t> _blocked_cells_versions;
+	mutable Vector2i _blocked_cells_size;
+	mutable GridOccupancy _merged_cells;
+	mutable String _merged_cells_key;
+	mutable uint64_t _merged_cells_version = 0;
+	mutable bool _merged_cells_valid = false;
+	mutable bool _placement_cached = false;
+	mutable uint64_t _placement_version = 0;
+	mutable String _placement_item_id;
+	mutable int _placement_amount = 0;
+	mutable Dictionary _placement_properties;
+	mutable Vector2i _placement_position;
+	mutable bool _placement_rotated = false;
+	mutable LocalVector<uint64_t> _placement_constraint_versions;
+	bool _has_insert_placement = false;
+	Vector2i _insert_position;
+	bool _insert_rotated = false;
 	bool _bounds_broken() const;
 	void _refresh_quad_tree();
-	bool _size_check(const Ref<ItemStack> stack1, const Ref<ItemStack> stack2);
+	Rect2i _make_stack_rect(const Ref<ItemStack> &stack, const Vector2i &position, const bool is_rotated) const;
+	int32_t _get_slot(const Ref<ItemStack> &stack) const;
+	int32_t _create_slot(const Ref<ItemStack> &stack, const int stack_index, const Vector2i &position, const bool is_rotated);
+	void _free_slot(const Ref<ItemStack> &stack);
+	void _reindex_slots(const int from_stack_index);
+	void _rebuild_slots();
+	int _get_stack_index(const Ref<ItemStack> &stack) const;
+	bool _size_check(const Ref<ItemStack> stack1, const GridInventory *other_inventory, const Ref<ItemStack> stack2) const;
 	bool _is_sorted();
 	void _move_stack_to_unsafe(const Ref<ItemStack> &stack, const Vector2i &position);
+	void _replace_slot_stack(const int stack_index, const Ref<ItemStack> &new_stack, const bool is_rotated);
+	void _place_stack_unsafe(const Ref<ItemStack> &stack, const Rect2i &rect);
+	void _unplace_stack_unsafe(const Ref<ItemStack> &stack);
+	void _clear_occupancy(const GridShape &shape);
+	const uint64_t *_get_shape_rows(const String &item_id, const bool is_rotated) const;
+	GridShape _get_item_shape(const String &item_id, const Rect2i &rect, const bool is_rotated) const;
+	GridShape _get_placed_shape(const Ref<ItemStack> &stack) const;
+	bool _shape_free(const GridShape &shape, const Ref<ItemStack> &exception = nullptr) const;
+	bool _find_placement(const String &item_id, const int amount, const Dictionary &properties, Vector2i &position, bool &is_rotated) const;
+	void _record_move_op(const int stack_index);
 	bool _compare_stacks(const Ref<ItemStack> &stack1, const Ref<ItemStack> &stack2) const;
 	void _sort_if_needed();
+	Vector2i _find_free_place_on(const GridOccupancy &grid, const Vector2i &final_size, const String &item_id, const int amount, const Dictionary &properties, const bool is_rotated, const GridShape &exception = GridShape()) const;
+	bool _find_packed_place(const GridOccupancy &grid, const String &item_id, const int amount, const Dictionary &properties, const Vector2i &item_size, Vector2i &position, bool &is_rotated) const;
+	void _fill_placement_mask(uint8_t *mask, const Rect2i &area, const Vector2i &final_size, const String &item_id, const int amount, const Dictionary &properties, const bool is_rotated, const Ref<ItemStack> &exception) const;
+	void _get_constraint_versions(LocalVector<uint64_t> &versions) const;
+	bool _constraint_versions_match(const LocalVector<uint64_t> &versions) const;
+	void _validate_blocked_cells() const;
+	String _get_blocked_cells_key(const String &item_id) const;
+	const GridOccupancy *_get_blocked_cells(const String &item_id) const;
+	const GridOccupancy &_get_search_cells(const GridOccupancy &grid, const String &item_id, GridOccupancy &scratch) const;
 	bool _can_add_on_position(const Vector2i position, const String item_id, const int amount, const Dictionary properties, const bool is_rotated) const;
 
 protected:
 	static void _bind_methods();
+	virtual bool _apply_op(const int op, const int stack_index, ByteReader &reader) override;
+	virtual void _fill_snapshot(InventorySnapshot *snapshot) const override;
+	virtual void _restore_snapshot(const InventorySnapshot *snapshot) override;
 
 public:
+	enum SortKey {
+		SORT_BY_AREA,
+		SORT_BY_HEIGHT,
+		SORT_BY_WIDTH,
+		SORT_BY_ITEM_ID,
+	};
+
 	virtual void _enter_tree() override;
 	const Vector2i DEFAULT_SIZE = Vector2i(8, 8);
 	GridInventory();
@@ -41,6 +113,7 @@ public:
 	TypedArray<GridInventoryConstraint> get_grid_constraints() const;
 	void set_quad_tree(const Ref<QuadTree> &new_quad_tree);
 	Ref<QuadTree> get_quad_tree() const;
+	virtual void set_stacks(const TypedArray<ItemStack> &new_stacks) override;
 	void set_stack_positions(const TypedArray<Vector2i> &new_stack_positions);
 	TypedArray<Vector2i> get_stack_positions() const;
 	void set_stack_rotations(const TypedArray<bool> &new_stack_rotations);
@@ -62,10 +135,15 @@ public:
 	TypedArray<ItemStack> get_stacks_under(const Rect2i rect) const;
 	bool move_stack_to(const Ref<ItemStack> stack, const Vector2i position);
 	int transfer_to(const Vector2i from_position, GridInventory *destination, const Vector2i destination_position, const int &amount = 1, const bool is_rotated = false);
+	bool transfer_stack_to(const Vector2i from_position, GridInventory *destination, const Vector2i destination_position, const bool is_rotated = false);
 	bool swap_stacks(const Vector2i position, GridInventory *other_inventory, const Vector2i other_position);
 	bool rect_free(const Rect2i &rect, const Ref<ItemStack> &exception = nullptr) const;
 	Vector2i find_free_place(const Vector2i stack_size, const String item_id, const int amount, const Dictionary properties, const bool is_rotated, const Ref<ItemStack> &exception = nullptr) const;
-	bool sort();
+	Array add_batch(const Array &items);
+	PackedByteArray get_placement_mask(const Vector2i item_size, const bool is_rotated = false, const String &item_id = "", const int amount = 1, const Dictionary &properties = Dictionary(), const Ref<ItemStack> &exception = nullptr) const;
+	PackedByteArray update_placement_mask(const PackedByteArray &mask, const Rect2i &changed_rect, const Vector2i item_size, const bool is_rotated = false, const String &item_id = "", const int amount = 1, const Dictionary &properties = Dictionary(), const Ref<ItemStack> &exception = nullptr) const;
+	bool sort(const int64_t time_budget_usec = 0, const int sort_key = SORT_BY_AREA);
+	virtual int defragment() override;
 	virtual Dictionary serialize() const override;
 	virtual void deserialize(const Dictionary data) override;
 	virtual bool can_add_new_stack(const String &item_id, const int &amount, const Dictionary &properties) const override;
@@ -75,4 +153,6 @@ public:
 	virtual void on_removed_stack(const Ref<ItemStack> stack, const int stack_index) override;
 };
 
+VARIANT_ENUM_CAST(GridInventory::SortKey);
+
 #endif // GRID_INVENTORY_CLASS_H
\ No newline at end of file
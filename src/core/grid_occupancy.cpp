@@ -0,0 +1,509 @@
+#include "grid_occupancy.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+uint64_t GridOccupancy::_word_mask(const int word_index, const int from_x, const int to_x) {
+	// Bits [from_x, to_x) of the row, restricted to the given word.
+	int word_start = word_index * 64;
+	int start = MAX(from_x - word_start, 0);
+	int end = MIN(to_x - word_start, 64);
+	if (start >= end)
+		return 0;
+	uint64_t high = end == 64 ? ~uint64_t(0) : (uint64_t(1) << end) - 1;
+	uint64_t low = (uint64_t(1) << start) - 1;
+	return high & ~low;
+}
+
+void GridOccupancy::_set_rect(const Rect2i &rect, const bool value) {
+	Rect2i clipped = rect.intersection(Rect2i(Vector2i(0, 0), size));
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return;
+	version++;
+	int from_x = clipped.position.x;
+	int to_x = clipped.position.x + clipped.size.x;
+	int first_word = from_x / 64;
+	int last_word = (to_x - 1) / 64;
+	for (int y = clipped.position.y; y < clipped.position.y + clipped.size.y; y++) {
+		uint64_t *row = words.ptr() + y * words_per_row;
+		for (int word_index = first_word; word_index <= last_word; word_index++) {
+			uint64_t mask = _word_mask(word_index, from_x, to_x);
+			_write_word(y, word_index, value ? row[word_index] | mask : row[word_index] & ~mask);
+		}
+	}
+}
+
+void GridOccupancy::_shift_right(const uint64_t *source, uint64_t *destination, const int shift) const {
+	// Shifts a whole row towards lower x, so bit x of the result is cell x + shift.
+	int word_shift = shift / 64;
+	int bit_shift = shift % 64;
+	for (int i = 0; i < words_per_row; i++) {
+		int from = i + word_shift;
+		uint64_t low = from < words_per_row ? source[from] >> bit_shift : 0;
+		uint64_t high = (bit_shift != 0 && from + 1 < words_per_row) ? source[from + 1] << (64 - bit_shift) : 0;
+		destination[i] = low | high;
+	}
+}
+
+int GridOccupancy::_lowest_bit(const uint64_t word) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return int(index);
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+int GridOccupancy::_count_bits(const uint64_t word) {
+#ifdef _MSC_VER
+	return int(__popcnt64(word));
+#else
+	return __builtin_popcountll(word);
+#endif
+}
+
+int64_t GridOccupancy::_count_shape_cells(const GridShape &shape) {
+	if (shape.rows == nullptr)
+		return int64_t(shape.rect.size.x) * shape.rect.size.y;
+	int64_t cells = 0;
+	for (int y = 0; y < shape.rect.size.y; y++) {
+		cells += _count_bits(shape.rows[y]);
+	}
+	return cells;
+}
+
+void GridOccupancy::_write_word(const int y, const int word_index, const uint64_t value) {
+	// Every write goes through here so the chunk counters stay exact.
+	uint64_t &word = words[y * words_per_row + word_index];
+	int delta = _count_bits(value) - _count_bits(word);
+	word = value;
+	if (delta == 0)
+		return;
+	int chunk_row = y / CHUNK_SIZE;
+	chunk_used[chunk_row * words_per_row + word_index] += delta;
+	chunk_row_used[chunk_row] += delta;
+}
+
+bool GridOccupancy::_is_chunk_blocked(const int chunk_x, const int chunk_y, const Rect2i &exception) const {
+	// A full chunk holds no free cell unless the exception frees some of it.
+	if (!is_chunk_full(Vector2i(chunk_x, chunk_y)))
+		return false;
+	if (exception.size.x <= 0 || exception.size.y <= 0)
+		return true;
+	return !Rect2i(chunk_x * CHUNK_SIZE, chunk_y * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE).intersects(exception);
+}
+
+int GridOccupancy::_skip_full_chunks(const int y, const Vector2i &rect_size, const int64_t cells, const Rect2i &exception, uint8_t *blocked) const {
+	// Returns y if the chunks under rows [y, y + rect_size.y) may still hold
+	// the item, otherwise the first later row whose band reaches a different
+	// set of chunk rows. When 'blocked' is given (rect items only), word
+	// columns with a full chunk in the band are marked: every row of that
+	// chunk is occupied there, so no rect of the band can use the column and
+	// the item must fit in a run of the remaining columns.
+	int first_chunk_row = y / CHUNK_SIZE;
+	int last_chunk_row = (y + rect_size.y - 1) / CHUNK_SIZE;
+	// Cells of the exception count as free.
+	int64_t exception_cells = int64_t(exception.size.x) * exception.size.y;
+	int64_t run_cells = 0;
+	int run_words = 0;
+	bool fits = false;
+	for (int i = 0; i < words_per_row; i++) {
+		int columns = MIN(CHUNK_SIZE, size.x - i * CHUNK_SIZE);
+		bool column_blocked = false;
+		int64_t column_free = 0;
+		for (int chunk_row = first_chunk_row; chunk_row <= last_chunk_row; chunk_row++) {
+			int rows = MIN(CHUNK_SIZE, size.y - chunk_row * CHUNK_SIZE);
+			column_free += columns * rows - chunk_used[chunk_row * words_per_row + i];
+			if (blocked != nullptr && _is_chunk_blocked(i, chunk_row, exception))
+				column_blocked = true;
+		}
+		if (blocked != nullptr)
+			blocked[i] = column_blocked;
+		if (column_blocked) {
+			run_cells = 0;
+			run_words = 0;
+			continue;
+		}
+		run_cells += column_free;
+		run_words++;
+		if (run_cells + exception_cells >= cells && (blocked == nullptr || run_words * CHUNK_SIZE >= rect_size.x))
+			fits = true;
+	}
+	if (fits)
+		return y;
+	int next_first = (first_chunk_row + 1) * CHUNK_SIZE;
+	int next_last = (last_chunk_row + 1) * CHUNK_SIZE - rect_size.y + 1;
+	return MIN(next_first, next_last);
+}
+
+void GridOccupancy::resize(const Vector2i &new_size) {
+	size = Vector2i(MAX(new_size.x, 0), MAX(new_size.y, 0));
+	words_per_row = (size.x + 63) / 64;
+	words.resize(words_per_row * size.y);
+	chunk_rows = (size.y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	chunk_used.resize(words_per_row * chunk_rows);
+	chunk_row_used.resize(chunk_rows);
+	clear_all();
+}
+
+Vector2i GridOccupancy::get_size() const {
+	return size;
+}
+
+int GridOccupancy::get_words_per_row() const {
+	return words_per_row;
+}
+
+uint64_t GridOccupancy::get_version() const {
+	return version;
+}
+
+uint64_t GridOccupancy::get_word(const int y, const int word_index) const {
+	return words[y * words_per_row + word_index];
+}
+
+int GridOccupancy::get_chunk_used_cells(const Vector2i &chunk) const {
+	if (chunk.x < 0 || chunk.y < 0 || chunk.x >= words_per_row || chunk.y >= chunk_rows)
+		return 0;
+	return chunk_used[chunk.y * words_per_row + chunk.x];
+}
+
+bool GridOccupancy::is_chunk_full(const Vector2i &chunk) const {
+	if (chunk.x < 0 || chunk.y < 0 || chunk.x >= words_per_row || chunk.y >= chunk_rows)
+		return false;
+	int columns = MIN(CHUNK_SIZE, size.x - chunk.x * CHUNK_SIZE);
+	int rows = MIN(CHUNK_SIZE, size.y - chunk.y * CHUNK_SIZE);
+	return chunk_used[chunk.y * words_per_row + chunk.x] == columns * rows;
+}
+
+void GridOccupancy::clear_all() {
+	version++;
+	for (uint32_t i = 0; i < words.size(); i++) {
+		words[i] = 0;
+	}
+	for (uint32_t i = 0; i < chunk_used.size(); i++) {
+		chunk_used[i] = 0;
+	}
+	for (uint32_t i = 0; i < chunk_row_used.size(); i++) {
+		chunk_row_used[i] = 0;
+	}
+}
+
+void GridOccupancy::fill(const Rect2i &rect) {
+	_set_rect(rect, true);
+}
+
+void GridOccupancy::clear(const Rect2i &rect) {
+	_set_rect(rect, false);
+}
+
+void GridOccupancy::merge(const GridOccupancy &other) {
+	ERR_FAIL_COND_MSG(other.size != size, "Only occupancies of the same size can be merged.");
+	version++;
+	for (int y = 0; y < size.y; y++) {
+		for (int i = 0; i < words_per_row; i++) {
+			int index = y * words_per_row + i;
+			if ((other.words[index] & ~words[index]) != 0)
+				_write_word(y, i, words[index] | other.words[index]);
+		}
+	}
+}
+
+bool GridOccupancy::is_occupied(const Vector2i &cell) const {
+	if (cell.x < 0 || cell.y < 0 || cell.x >= size.x || cell.y >= size.y)
+		return false;
+	return (words[cell.y * words_per_row + cell.x / 64] >> (cell.x % 64)) & 1;
+}
+
+bool GridOccupancy::is_free(const Rect2i &rect, const Rect2i &exception) const {
+	// Cells outside the grid count as free; callers check bounds themselves.
+	Rect2i clipped = rect.intersection(Rect2i(Vector2i(0, 0), size));
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return true;
+	int from_x = clipped.position.x;
+	int to_x = clipped.position.x + clipped.size.x;
+	int first_word = from_x / 64;
+	int last_word = (to_x - 1) / 64;
+	bool has_exception = exception.size.x > 0 && exception.size.y > 0;
+	int exception_from_y = exception.position.y;
+	int exception_to_y = exception.position.y + exception.size.y;
+	for (int y = clipped.position.y; y < clipped.position.y + clipped.size.y; y++) {
+		const uint64_t *row = words.ptr() + y * words_per_row;
+		// Cells of the exception stack are only ignored on the rows it covers.
+		bool exception_row = has_exception && y >= exception_from_y && y < exception_to_y;
+		for (int word_index = first_word; word_index <= last_word; word_index++) {
+			uint64_t mask = _word_mask(word_index, from_x, to_x);
+			if (exception_row)
+				mask &= ~_word_mask(word_index, exception.position.x, exception.position.x + exception.size.x);
+			if (row[word_index] & mask)
+				return false;
+		}
+	}
+	return true;
+}
+
+void GridOccupancy::_find_row_origins(const int y, const Vector2i &rect_size, const Rect2i &exception, const uint8_t *blocked, uint64_t *runs, uint64_t *shifted) const {
+	// Each candidate row band is OR-ed into one bit row, then runs of
+	// rect_size.x free bits are found with log2(width) shift-and steps.
+	// Blocked word columns are taken as occupied without reading their rows.
+	for (int i = 0; i < words_per_row; i++) {
+		runs[i] = blocked[i] ? ~uint64_t(0) : 0;
+	}
+	bool has_exception = exception.size.x > 0 && exception.size.y > 0;
+	for (int row_y = y; row_y < y + rect_size.y; row_y++) {
+		const uint64_t *row = words.ptr() + row_y * words_per_row;
+		bool exception_row = has_exception && row_y >= exception.position.y && row_y < exception.position.y + exception.size.y;
+		for (int i = 0; i < words_per_row; i++) {
+			if (blocked[i])
+				continue;
+			uint64_t occupied = row[i];
+			if (exception_row)
+				occupied &= ~_word_mask(i, exception.position.x, exception.position.x + exception.size.x);
+			runs[i] |= occupied;
+		}
+	}
+	for (int i = 0; i < words_per_row; i++) {
+		runs[i] = ~runs[i];
+	}
+	int last_bits = size.x % 64;
+	runs[words_per_row - 1] &= last_bits == 0 ? ~uint64_t(0) : (uint64_t(1) << last_bits) - 1;
+	// Bit x of runs ends up set when cells [x, x + length) are all free.
+	int length = 1;
+	while (length < rect_size.x) {
+		int step = MIN(length, rect_size.x - length);
+		_shift_right(runs, shifted, step);
+		for (int i = 0; i < words_per_row; i++) {
+			runs[i] &= shifted[i];
+		}
+		length += step;
+	}
+}
+
+Vector2i GridOccupancy::find_free(const Vector2i &rect_size, const Rect2i &exception, const Vector2i &from) const {
+	// First free origin at or after 'from' in row-major order, so no cell is
+	// visited twice.
+	if (rect_size.x < 1 || rect_size.y < 1 || rect_size.x > size.x || rect_size.y > size.y)
+		return Vector2i(-1, -1);
+	LocalVector<uint64_t> runs;
+	LocalVector<uint64_t> shifted;
+	LocalVector<uint8_t> blocked;
+	runs.resize(words_per_row);
+	shifted.resize(words_per_row);
+	blocked.resize(words_per_row);
+	int64_t cells = int64_t(rect_size.x) * rect_size.y;
+	for (int y = MAX(from.y, 0); y <= size.y - rect_size.y; y++) {
+		int next_y = _skip_full_chunks(y, rect_size, cells, exception, blocked.ptr());
+		if (next_y != y) {
+			y = next_y - 1;
+			continue;
+		}
+		_find_row_origins(y, rect_size, exception, blocked.ptr(), runs.ptr(), shifted.ptr());
+		if (y == from.y && from.x > 0) {
+			for (int i = 0; i < words_per_row; i++) {
+				runs[i] &= ~_word_mask(i, 0, from.x);
+			}
+		}
+		for (int i = 0; i < words_per_row; i++) {
+			if (runs[i] != 0)
+				return Vector2i(i * 64 + _lowest_bit(runs[i]), y);
+		}
+	}
+	return Vector2i(-1, -1);
+}
+
+void GridOccupancy::_find_row_shape_origins(const int y, const GridShape &shape, const GridShape &exception, uint64_t *origins, uint64_t *free_cells, uint64_t *shifted) const {
+	// Origin x survives when every cell (x + c, y + dy) of the shape is free,
+	// so each shape cell ANDs in the free row shifted by its column. Words of
+	// full chunks are taken as occupied without reading the row.
+	int width = shape.rect.size.x;
+	for (int i = 0; i < words_per_row; i++) {
+		origins[i] = _word_mask(i, 0, size.x - width + 1);
+	}
+	for (int dy = 0; dy < shape.rect.size.y; dy++) {
+		int row_y = y + dy;
+		const uint64_t *row = words.ptr() + row_y * words_per_row;
+		int chunk_row = row_y / CHUNK_SIZE;
+		for (int i = 0; i < words_per_row; i++) {
+			if (_is_chunk_blocked(i, chunk_row, exception.rect))
+				free_cells[i] = 0;
+			else
+				free_cells[i] = ~(row[i] & ~exception.get_row_word(row_y, i)) & _word_mask(i, 0, size.x);
+		}
+		for (int c = 0; c < width; c++) {
+			if (shape.rows != nullptr && !((shape.rows[dy] >> c) & 1))
+				continue;
+			_shift_right(free_cells, shifted, c);
+			uint64_t any = 0;
+			for (int i = 0; i < words_per_row; i++) {
+				origins[i] &= shifted[i];
+				any |= origins[i];
+			}
+			if (any == 0)
+				return;
+		}
+	}
+}
+
+void GridOccupancy::get_free_origins(const GridShape &shape, const GridShape &exception, const int from_y, const int to_y, LocalVector<uint64_t> &origins) const {
+	// One bit row of valid origins per row in [from_y, to_y), laid out like
+	// the occupancy words; rows outside the grid stay empty.
+	int row_count = MAX(to_y - from_y, 0);
+	origins.resize(words_per_row * row_count);
+	for (uint32_t i = 0; i < origins.size(); i++) {
+		origins[i] = 0;
+	}
+	Vector2i rect_size = shape.rect.size;
+	if (rect_size.x < 1 || rect_size.y < 1 || rect_size.x > size.x || rect_size.y > size.y)
+		return;
+	bool is_rect = shape.rows == nullptr && exception.rows == nullptr;
+	LocalVector<uint64_t> free_cells;
+	LocalVector<uint64_t> shifted;
+	LocalVector<uint8_t> blocked;
+	free_cells.resize(words_per_row);
+	shifted.resize(words_per_row);
+	blocked.resize(words_per_row);
+	int64_t cells = _count_shape_cells(shape);
+	for (int y = MAX(from_y, 0); y < MIN(to_y, size.y - rect_size.y + 1); y++) {
+		// Blocked columns only rule out rects; a shape may skip the full rows.
+		int next_y = _skip_full_chunks(y, rect_size, cells, exception.rect, is_rect ? blocked.ptr() : nullptr);
+		if (next_y != y) {
+			y = next_y - 1;
+			continue;
+		}
+		uint64_t *runs = origins.ptr() + (y - from_y) * words_per_row;
+		if (is_rect)
+			_find_row_origins(y, rect_size, exception.rect, blocked.ptr(), runs, shifted.ptr());
+		else
+			_find_row_shape_origins(y, shape, exception, runs, free_cells.ptr(), shifted.ptr());
+	}
+}
+
+void GridOccupancy::fill_shape(const GridShape &shape) {
+	if (shape.rows == nullptr) {
+		_set_rect(shape.rect, true);
+		return;
+	}
+	Rect2i clipped = shape.rect.intersection(Rect2i(Vector2i(0, 0), size));
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return;
+	version++;
+	int first_word = clipped.position.x / 64;
+	int last_word = (clipped.position.x + clipped.size.x - 1) / 64;
+	for (int y = clipped.position.y; y < clipped.position.y + clipped.size.y; y++) {
+		uint64_t *row = words.ptr() + y * words_per_row;
+		for (int word_index = first_word; word_index <= last_word; word_index++) {
+			_write_word(y, word_index, row[word_index] | (shape.get_row_word(y, word_index) & _word_mask(word_index, 0, size.x)));
+		}
+	}
+}
+
+void GridOccupancy::clear_shape(const GridShape &shape) {
+	if (shape.rows == nullptr) {
+		_set_rect(shape.rect, false);
+		return;
+	}
+	Rect2i clipped = shape.rect.intersection(Rect2i(Vector2i(0, 0), size));
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return;
+	version++;
+	int first_word = clipped.position.x / 64;
+	int last_word = (clipped.position.x + clipped.size.x - 1) / 64;
+	for (int y = clipped.position.y; y < clipped.position.y + clipped.size.y; y++) {
+		uint64_t *row = words.ptr() + y * words_per_row;
+		for (int word_index = first_word; word_index <= last_word; word_index++) {
+			_write_word(y, word_index, row[word_index] & ~shape.get_row_word(y, word_index));
+		}
+	}
+}
+
+bool GridOccupancy::is_shape_free(const GridShape &shape, const GridShape &exception) const {
+	if (shape.rows == nullptr && exception.rows == nullptr)
+		return is_free(shape.rect, exception.rect);
+	// Cells outside the grid count as free; callers check bounds themselves.
+	Rect2i clipped = shape.rect.intersection(Rect2i(Vector2i(0, 0), size));
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return true;
+	int first_word = clipped.position.x / 64;
+	int last_word = (clipped.position.x + clipped.size.x - 1) / 64;
+	for (int y = clipped.position.y; y < clipped.position.y + clipped.size.y; y++) {
+		const uint64_t *row = words.ptr() + y * words_per_row;
+		for (int word_index = first_word; word_index <= last_word; word_index++) {
+			uint64_t occupied = row[word_index] & ~exception.get_row_word(y, word_index);
+			if (occupied & shape.get_row_word(y, word_index))
+				return false;
+		}
+	}
+	return true;
+}
+
+Vector2i GridOccupancy::find_free_shape(const GridShape &shape, const GridShape &exception, const Vector2i &from) const {
+	if (shape.rows == nullptr && exception.rows == nullptr)
+		return find_free(shape.rect.size, exception.rect, from);
+	Vector2i rect_size = shape.rect.size;
+	if (rect_size.x < 1 || rect_size.y < 1 || rect_size.x > size.x || rect_size.y > size.y)
+		return Vector2i(-1, -1);
+	LocalVector<uint64_t> origins;
+	LocalVector<uint64_t> free_cells;
+	LocalVector<uint64_t> shifted;
+	origins.resize(words_per_row);
+	free_cells.resize(words_per_row);
+	shifted.resize(words_per_row);
+	int64_t cells = _count_shape_cells(shape);
+	for (int y = MAX(from.y, 0); y <= size.y - rect_size.y; y++) {
+		int next_y = _skip_full_chunks(y, rect_size, cells, exception.rect, nullptr);
+		if (next_y != y) {
+			y = next_y - 1;
+			continue;
+		}
+		_find_row_shape_origins(y, shape, exception, origins.ptr(), free_cells.ptr(), shifted.ptr());
+		if (y == from.y && from.x > 0) {
+			for (int i = 0; i < words_per_row; i++) {
+				origins[i] &= ~_word_mask(i, 0, from.x);
+			}
+		}
+		for (int i = 0; i < words_per_row; i++) {
+			if (origins[i] != 0)
+				return Vector2i(i * 64 + _lowest_bit(origins[i]), y);
+		}
+	}
+	return Vector2i(-1, -1);
+}
+
+uint64_t GridShape::get_row_word(const int y, const int word_index) const {
+	// Cells of the shape on grid row y that fall into the given word.
+	if (y < rect.position.y || y >= rect.position.y + rect.size.y)
+		return 0;
+	if (rows == nullptr)
+		return GridOccupancy::_word_mask(word_index, rect.position.x, rect.position.x + rect.size.x);
+	uint64_t bits = rows[y - rect.position.y];
+	int offset = rect.position.x - word_index * 64;
+	if (offset >= 64 || offset <= -64)
+		return 0;
+	return offset >= 0 ? bits << offset : bits >> -offset;
+}
+
+bool GridShape::has_cell(const Vector2i &cell) const {
+	if (!rect.has_point(cell))
+		return false;
+	if (rows == nullptr)
+		return true;
+	return (rows[cell.y - rect.position.y] >> (cell.x - rect.position.x)) & 1;
+}
+
+bool GridShape::intersects(const Rect2i &other) const {
+	Rect2i clipped = rect.intersection(other);
+	if (clipped.size.x <= 0 || clipped.size.y <= 0)
+		return false;
+	if (rows == nullptr)
+		return true;
+	int from_x = clipped.position.x - rect.position.x;
+	int to_x = from_x + clipped.size.x;
+	uint64_t mask = GridOccupancy::_word_mask(0, from_x, to_x);
+	for (int y = clipped.position.y; y < clipped.position.y + clipped.size.y; y++) {
+		if (rows[y - rect.position.y] & mask)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,76 @@
+#ifndef GRID_OCCUPANCY_H
+#define GRID_OCCUPANCY_H
+
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/variant/rect2i.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+using namespace godot;
+
+// Cells of a placed item: its bounding rect, plus one bit row per rect row
+// when the item is not a full rectangle (rows == nullptr otherwise).
+struct GridShape {
+	Rect2i rect;
+	const uint64_t *rows = nullptr;
+
+	GridShape() {}
+	GridShape(const Rect2i &p_rect, const uint64_t *p_rows = nullptr) :
+			rect(p_rect), rows(p_rows) {}
+	uint64_t get_row_word(const int y, const int word_index) const;
+	bool has_cell(const Vector2i &cell) const;
+	bool intersects(const Rect2i &other) const;
+};
+
+// One bit per grid cell, stored as rows of 64-bit words. A rect test is a
+// masked AND per row and word, so 64 columns are checked at a time.
+// Cells are also counted per 64x64 chunk, so searches can skip word columns
+// of full chunks and bands of chunks that are too full to hold the item.
+class GridOccupancy {
+	friend struct GridShape;
+
+public:
+	static const int CHUNK_SIZE = 64;
+
+private:
+	Vector2i size;
+	int words_per_row = 0;
+	LocalVector<uint64_t> words;
+	int chunk_rows = 0;
+	LocalVector<uint16_t> chunk_used;
+	LocalVector<int64_t> chunk_row_used;
+	uint64_t version = 0;
+	static int _count_bits(const uint64_t word);
+	static int64_t _count_shape_cells(const GridShape &shape);
+	void _write_word(const int y, const int word_index, const uint64_t value);
+	bool _is_chunk_blocked(const int chunk_x, const int chunk_y, const Rect2i &exception) const;
+	int _skip_full_chunks(const int y, const Vector2i &rect_size, const int64_t cells, const Rect2i &exception, uint8_t *blocked) const;
+	static uint64_t _word_mask(const int word_index, const int from_x, const int to_x);
+	void _set_rect(const Rect2i &rect, const bool value);
+	void _shift_right(const uint64_t *source, uint64_t *destination, const int shift) const;
+	static int _lowest_bit(const uint64_t word);
+	void _find_row_origins(const int y, const Vector2i &rect_size, const Rect2i &exception, const uint8_t *blocked, uint64_t *runs, uint64_t *shifted) const;
+	void _find_row_shape_origins(const int y, const GridShape &shape, const GridShape &exception, uint64_t *origins, uint64_t *free_cells, uint64_t *shifted) const;
+
+public:
+	void resize(const Vector2i &new_size);
+	Vector2i get_size() const;
+	int get_words_per_row() const;
+	uint64_t get_version() const;
+	uint64_t get_word(const int y, const int word_index) const;
+	int get_chunk_used_cells(const Vector2i &chunk) const;
+	bool is_chunk_full(const Vector2i &chunk) const;
+	void clear_all();
+	void fill(const Rect2i &rect);
+	void clear(const Rect2i &rect);
+	void merge(const GridOccupancy &other);
+	bool is_occupied(const Vector2i &cell) const;
+	bool is_free(const Rect2i &rect, const Rect2i &exception = Rect2i()) const;
+	Vector2i find_free(const Vector2i &rect_size, const Rect2i &exception = Rect2i(), const Vector2i &from = Vector2i(0, 0)) const;
+	void get_free_origins(const GridShape &shape, const GridShape &exception, const int from_y, const int to_y, LocalVector<uint64_t> &origins) const;
+	void fill_shape(const GridShape &shape);
+	void clear_shape(const GridShape &shape);
+	bool is_shape_free(const GridShape &shape, const GridShape &exception = GridShape()) const;
+	Vector2i find_free_shape(const GridShape &shape, const GridShape &exception = GridShape(), const Vector2i &from = Vector2i(0, 0)) const;
+};
+
+#endif // GRID_OCCUPANCY_H
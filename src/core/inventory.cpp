@@ -15,6 +15,8 @@ void Inventory::_enter_tree() {
 }
 
 void Inventory::set_stack_content(const int stack_index, const String &item_id, const int &amount, const Dictionary &properties) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_MSG(stack_index < 0 || stack_index >= stacks.size(), "The 'stack_index' is out of bounds.");
 	ERR_FAIL_COND_MSG(amount < 0, "The 'amount' is negative.");
 
@@ -24,6 +26,7 @@ void Inventory::set_stack_content(const int stack_index, const String &item_id,
 	stack->set_amount(amount);
 	stack->set_properties(properties);
 	stacks[stack_index] = stack;
+	_record_stack_op(OP_SET, stack_index);
 	emit_signal("updated_stack", stack_index);
 	_call_events(old_amount);
 }
@@ -33,6 +36,7 @@ bool Inventory::is_empty() const {
 }
 
 bool Inventory::is_full() const {
+	_ensure_loaded();
 	for (size_t i = 0; i < stacks.size(); i++) {
 		Ref<ItemStack> stack = stacks[i];
 		Ref<ItemDefinition> definition = get_database()->get_item(stack->get_item_id());
@@ -43,6 +47,7 @@ bool Inventory::is_full() const {
 }
 
 void Inventory::clear() {
+	_ensure_loaded();
 	for (int i = stacks.size() - 1; i >= 0; i--) {
 		Ref<ItemStack> stack = stacks[i];
 		remove_at(i, stack->get_item_id(), stack->get_amount());
@@ -50,6 +55,8 @@ void Inventory::clear() {
 }
 
 bool Inventory::contains(const String &item_id, const int &amount) const {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(amount < 0, false, "'amount' is negative.");
 
 	int amount_in_inventory = 0;
@@ -66,6 +73,8 @@ bool Inventory::contains(const String &item_id, const int &amount) const {
 }
 
 bool Inventory::contains_at(const int &stack_index, const String &item_id, const int &amount) const {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), false, "The 'slot index' is out of bounds.");
 	ERR_FAIL_COND_V_MSG(amount < 0, false, "The 'amount' is negative.");
 
@@ -79,6 +88,8 @@ bool Inventory::contains_at(const int &stack_index, const String &item_id, const
 }
 
 bool Inventory::contains_category(const Ref<ItemCategory> &category, const int &amount) const {
+	_ensure_loaded();
+
 	ERR_FAIL_NULL_V_MSG(category, false, "'category' is null.");
 	ERR_FAIL_COND_V_MSG(amount < 0, false, "The 'amount' is negative.");
 
@@ -100,6 +111,8 @@ bool Inventory::has_space_for(const String &item_id, const int amount, const Dic
 }
 
 bool Inventory::can_stack_with_actual_slots(const String &item_id, const int amount, const Dictionary &properties) const {
+	_ensure_loaded();
+
 	ERR_FAIL_NULL_V_MSG(get_database(), false, "'database' is null.");
 	Ref<ItemDefinition> definition = get_database()->get_item(item_id);
 	ERR_FAIL_NULL_V_MSG(definition, false, "'definition' is null.");
@@ -118,6 +131,7 @@ bool Inventory::can_stack_with_actual_slots(const String &item_id, const int amo
 }
 
 bool Inventory::has_stack(const Ref<ItemStack> &stack) const {
+	_ensure_loaded();
 	for (size_t i = 0; i < stacks.size(); i++) {
 		if (stacks[i] == stack)
 			return true;
@@ -126,6 +140,8 @@ bool Inventory::has_stack(const Ref<ItemStack> &stack) const {
 }
 
 int Inventory::get_stack_index_with_an_item_of_category(const Ref<ItemCategory> &category) const {
+	_ensure_loaded();
+
 	ERR_FAIL_NULL_V_MSG(category, 0, "'category' is null.");
 
 	int amount_in_inventory = 0;
@@ -139,6 +155,7 @@ int Inventory::get_stack_index_with_an_item_of_category(const Ref<ItemCategory>
 }
 
 int Inventory::amount_of_item(const String &item_id) const {
+	_ensure_loaded();
 	int amount_in_inventory = 0;
 	for (size_t i = 0; i < stacks.size(); i++) {
 		Ref<ItemStack> stack = stacks[i];
@@ -150,6 +167,8 @@ int Inventory::amount_of_item(const String &item_id) const {
 }
 
 int Inventory::amount_of_category(const Ref<ItemCategory> &category) const {
+	_ensure_loaded();
+
 	ERR_FAIL_NULL_V_MSG(category, 0, "'category' is null.");
 
 	int amount_in_inventory = 0;
@@ -166,6 +185,7 @@ int Inventory::amount_of_category(const Ref<ItemCategory> &category) const {
 }
 
 int Inventory::amount() const {
+	_ensure_loaded();
 	int amount_in_inventory = 0;
 	for (size_t i = 0; i < stacks.size(); i++) {
 		Ref<ItemStack> stack = stacks[i];
@@ -178,6 +198,8 @@ int Inventory::amount() const {
 }
 
 int Inventory::add(const String &item_id, const int &amount, const Dictionary &properties, const bool &drop_excess) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(amount < 0, amount, "The 'amount' is negative.");
 
 	int amount_in_interact = amount;
@@ -224,6 +246,8 @@ int Inventory::add(const String &item_id, const int &amount, const Dictionary &p
 }
 
 int Inventory::add_at_index(const int &stack_index, const String &item_id, const int &amount, const Dictionary &properties) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), amount, "The 'slot index' is out of bounds.");
 	ERR_FAIL_COND_V_MSG(amount < 0, amount, "The 'amount' is negative.");
 
@@ -241,6 +265,7 @@ int Inventory::add_at_index(const int &stack_index, const String &item_id, const
 }
 
 int Inventory::add_on_new_stack(const String &item_id, const int &amount, const Dictionary &properties, const bool can_emit_signal) {
+	_ensure_loaded();
 	if (!can_add_new_stack(item_id, amount, properties))
 		return amount;
 
@@ -258,6 +283,7 @@ int Inventory::add_on_new_stack(const String &item_id, const int &amount, const
 }
 
 int Inventory::insert_stack(const int &stack_index, const String &item_id, const int &amount, const Dictionary &properties, const bool can_emit_signal) {
+	_ensure_loaded();
 	Ref<ItemStack> stack = memnew(ItemStack());
 	stacks.append(stack);
 	stack->set_item_id(item_id);
@@ -268,6 +294,7 @@ int Inventory::insert_stack(const int &stack_index, const String &item_id, const
 	stack->set_amount(amount_to_add);
 	stack->set_properties(properties);
 	// int no_added = add_at_index(stacks.size() - 1, item_id, amount, properties);
+	_record_stack_op(OP_INSERT, stacks.size() - 1);
 	on_insert_stack(stack_index);
 	if (can_emit_signal) {
 		this->emit_signal("stack_added", stacks.size() - 1);
@@ -276,12 +303,15 @@ int Inventory::insert_stack(const int &stack_index, const String &item_id, const
 }
 
 void Inventory::remove_stack(const int &stack_index) {
+	_ensure_loaded();
 	int old_amount = this->amount();
 	_remove_stack_at(stack_index);
 	_call_events(old_amount);
 }
 
 int Inventory::remove(const String &item_id, const int &amount) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(amount < 0, amount, "The 'amount' is negative.");
 
 	int amount_in_interact = amount;
@@ -306,6 +336,8 @@ int Inventory::remove(const String &item_id, const int &amount) {
 }
 
 int Inventory::remove_at(const int &stack_index, const String &item_id, const int &amount) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), amount, "The 'stack_index' is out of bounds.");
 	ERR_FAIL_COND_V_MSG(amount < 0, amount, "The 'amount' is negative.");
 
@@ -328,6 +360,8 @@ int Inventory::remove_at(const int &stack_index, const String &item_id, const in
 }
 
 bool Inventory::split(const int &stack_index, const int &amount) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), false, "The 'stack index' is out of bounds.");
 
 	int amount_in_interaction = amount;
@@ -349,7 +383,59 @@ bool Inventory::split(const int &stack_index, const int &amount) {
 	return false;
 }
 
+int Inventory::defragment() {
+	_ensure_loaded();
+	int removed = 0;
+	if (_merge_stacks(removed))
+		_flag_contents_changed = true;
+	return removed;
+}
+
+bool Inventory::_merge_stacks(int &removed) {
+	ERR_FAIL_NULL_V_MSG(get_database(), false, "The 'database' is null.");
+	// Amounts are moved silently into the first stack with room; only the
+	// stacks left empty are announced, through stack_removed.
+	bool changed = false;
+	for (int i = 0; i < stacks.size(); i++) {
+		Ref<ItemStack> target = stacks[i];
+		if (target == nullptr || target->get_amount() <= 0)
+			continue;
+		String item_id = target->get_item_id();
+		Ref<ItemDefinition> definition = get_database()->get_item(item_id);
+		if (definition == nullptr || !definition->get_can_stack())
+			continue;
+		Dictionary properties = target->get_properties();
+		int max_stack = _get_max_stack_for_stack(item_id, target->get_amount(), properties);
+		for (int j = i + 1; j < stacks.size() && target->get_amount() < max_stack; j++) {
+			Ref<ItemStack> source = stacks[j];
+			if (source == nullptr || source->get_amount() <= 0 || source->get_item_id() != item_id || source->get_properties() != properties)
+				continue;
+			int moved = MIN(max_stack - target->get_amount(), source->get_amount());
+			target->restore(item_id, target->get_amount() + moved, target->get_properties());
+			source->restore(item_id, source->get_amount() - moved, source->get_properties());
+			if (_is_recording_ops()) {
+				_begin_op(OP_AMOUNT, i).put_zigzag(moved);
+				_begin_op(OP_AMOUNT, j).put_zigzag(-moved);
+			}
+			changed = true;
+		}
+	}
+
+	removed = 0;
+	for (int i = stacks.size() - 1; i >= 0; i--) {
+		Ref<ItemStack> stack = stacks[i];
+		if (stack == nullptr || stack->get_amount() > 0)
+			continue;
+		// Walking backwards keeps each emitted index valid when it is emitted.
+		_remove_stack_at(i);
+		removed++;
+	}
+	return changed;
+}
+
 int Inventory::transfer_at(const int &stack_index, Inventory *destination, const int &destination_stack_index, const int &amount) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), amount, "The 'stack index' is out of bounds.");
 	ERR_FAIL_NULL_V_MSG(destination, amount, "Destination inventory is null on transfer.");
 	ERR_FAIL_NULL_V_MSG(get_database(), amount, "InventoryDatabase is null.");
@@ -383,6 +469,8 @@ int Inventory::transfer_at(const int &stack_index, Inventory *destination, const
 }
 
 int Inventory::transfer(const int &stack_index, Inventory *destination, const int &amount) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), amount, "The 'stack index' is out of bounds.");
 	ERR_FAIL_NULL_V_MSG(destination, amount, "Destination inventory is null on transfer.");
 	ERR_FAIL_NULL_V_MSG(get_database(), amount, "InventoryDatabase is null.");
@@ -396,6 +484,9 @@ int Inventory::transfer(const int &stack_index, Inventory *destination, const in
 	int amount_to_interact = amount;
 	if (amount_to_interact == 0)
 		return amount;
+	// A whole stack with nothing to merge into is handed over as is.
+	if (amount_to_interact >= stack->get_amount() && !destination->contains(item_id) && transfer_stack(stack_index, destination))
+		return 0;
 	int amount_not_removed = remove_at(stack_index, item_id, amount_to_interact);
 	int amount_to_transfer = amount_to_interact - amount_not_removed;
 	if (amount_to_transfer == 0)
@@ -405,11 +496,39 @@ int Inventory::transfer(const int &stack_index, Inventory *destination, const in
 	return amount_not_transferred;
 }
 
+bool Inventory::transfer_stack(const int &stack_index, Inventory *destination) {
+	_ensure_loaded();
+
+	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), false, "The 'stack index' is out of bounds.");
+	ERR_FAIL_NULL_V_MSG(destination, false, "Destination inventory is null on transfer.");
+	ERR_FAIL_NULL_V_MSG(get_database(), false, "InventoryDatabase is null.");
+	ERR_FAIL_NULL_V_MSG(destination->get_database(), false, "InventoryDatabase is null.");
+	ERR_FAIL_COND_V_MSG(get_database() != destination->get_database(), false, "Operation between inventories that do not have the same database is invalid.");
+
+	if (destination == this)
+		return false;
+	destination->_ensure_loaded();
+	Ref<ItemStack> stack = stacks[stack_index];
+	String item_id = stack->get_item_id();
+	int amount = stack->get_amount();
+	Dictionary properties = stack->get_properties();
+	if (!destination->can_add_new_stack(item_id, amount, properties))
+		return false;
+	if (!_can_swap_to_inventory(destination, item_id, amount, properties))
+		return false;
+	_detach_stack(stack_index);
+	destination->_attach_stack(stack);
+	return true;
+}
+
 void Inventory::set_stacks(const TypedArray<ItemStack> &new_items) {
+	_pending_data = Dictionary();
+	_has_pending_data = false;
 	stacks = new_items;
 }
 
 TypedArray<ItemStack> Inventory::get_stacks() const {
+	_ensure_loaded();
 	return stacks;
 }
 
@@ -429,13 +548,280 @@ TypedArray<InventoryConstraint> Inventory::get_constraints() const {
 	return constraints;
 }
 
+void Inventory::set_lazy_deserialize(const bool &new_lazy_deserialize) {
+	lazy_deserialize = new_lazy_deserialize;
+}
+
+bool Inventory::get_lazy_deserialize() const {
+	return lazy_deserialize;
+}
+
+bool Inventory::has_pending_data() const {
+	return _has_pending_data;
+}
+
+void Inventory::set_record_ops(const bool &new_record_ops) {
+	if (new_record_ops && !record_ops)
+		_ops_cursor = ops_sequence;
+	record_ops = new_record_ops;
+	_trim_ops();
+}
+
+bool Inventory::get_record_ops() const {
+	return record_ops;
+}
+
+void Inventory::set_ops_sequence(const int64_t &new_ops_sequence) {
+	// Renumbering starts a new stream for every consumer.
+	ops_sequence = new_ops_sequence;
+	_ops.clear();
+	_ops_offsets.clear();
+	_ops_cursor = ops_sequence;
+	for (KeyValue<int64_t, int64_t> &E : _ops_listeners) {
+		E.value = ops_sequence;
+	}
+}
+
+int64_t Inventory::get_ops_sequence() const {
+	return ops_sequence;
+}
+
+PackedByteArray Inventory::take_ops() {
+	if (!record_ops)
+		return PackedByteArray();
+	return _take_ops_from(_ops_cursor);
+}
+
+int64_t Inventory::add_ops_listener() {
+	int64_t listener_id = _next_ops_listener++;
+	_ops_listeners.insert(listener_id, ops_sequence);
+	return listener_id;
+}
+
+void Inventory::remove_ops_listener(const int64_t listener_id) {
+	_ops_listeners.erase(listener_id);
+	_trim_ops();
+}
+
+PackedByteArray Inventory::take_listener_ops(const int64_t listener_id) {
+	int64_t *cursor = _ops_listeners.getptr(listener_id);
+	ERR_FAIL_NULL_V_MSG(cursor, PackedByteArray(), vformat("Unknown ops listener %d.", listener_id));
+	return _take_ops_from(*cursor);
+}
+
+PackedByteArray Inventory::_take_ops_from(int64_t &cursor) {
+	int64_t first_sequence = ops_sequence - _ops_offsets.size();
+	cursor = MAX(cursor, first_sequence);
+	if (cursor >= ops_sequence)
+		return PackedByteArray();
+	ByteWriter writer;
+	writer.put_varint(cursor);
+	writer.put_varint(ops_sequence - cursor);
+	PackedByteArray result = writer.to_packed();
+	result.append_array(_ops.to_packed(_ops_offsets[cursor - first_sequence]));
+	cursor = ops_sequence;
+	_trim_ops();
+	return result;
+}
+
+void Inventory::_trim_ops() {
+	// Ops are kept until the slowest consumer has taken them.
+	int64_t keep_from = ops_sequence;
+	if (record_ops)
+		keep_from = MIN(keep_from, _ops_cursor);
+	for (const KeyValue<int64_t, int64_t> &E : _ops_listeners) {
+		keep_from = MIN(keep_from, E.value);
+	}
+	int64_t count = _ops_offsets.size();
+	int64_t drop = keep_from - (ops_sequence - count);
+	if (drop <= 0)
+		return;
+	if (drop >= count) {
+		_ops.clear();
+		_ops_offsets.clear();
+		return;
+	}
+	int64_t drop_bytes = _ops_offsets[drop];
+	_ops.erase_front(drop_bytes);
+	for (int64_t i = drop; i < count; i++) {
+		_ops_offsets[i - drop] = _ops_offsets[i] - drop_bytes;
+	}
+	_ops_offsets.resize(count - drop);
+}
+
+bool Inventory::apply_ops(const PackedByteArray &ops) {
+	if (ops.is_empty())
+		return true;
+	_ensure_loaded();
+	ByteReader reader = ByteReader(ops);
+	int64_t sequence = reader.get_varint();
+	int64_t count = reader.get_varint();
+	ERR_FAIL_COND_V_MSG(reader.has_error(), false, "Ops data is invalid.");
+	ERR_FAIL_COND_V_MSG(sequence != ops_sequence, false, vformat("Ops sequence mismatch: expected %d, got %d. Resync this inventory with serialize().", ops_sequence, sequence));
+
+	int old_amount = amount();
+	bool result = true;
+	int64_t body_start = reader.get_position();
+	LocalVector<int64_t> op_starts;
+	_applying_ops = true;
+	for (int64_t i = 0; i < count; i++) {
+		op_starts.push_back(reader.get_position() - body_start);
+		int op = reader.get_u8();
+		int stack_index = reader.get_varint();
+		if (reader.has_error() || !_apply_op(op, stack_index, reader) || reader.has_error()) {
+			result = false;
+			break;
+		}
+	}
+	_applying_ops = false;
+	ERR_FAIL_COND_V_MSG(!result, false, "Ops data is invalid. Resync this inventory with serialize().");
+	if (record_ops || !_ops_listeners.is_empty()) {
+		// Applied ops continue this inventory's own stream, so its consumers
+		// (a journal on a replica, for example) see them too.
+		int64_t log_start = _ops.size();
+		for (uint32_t i = 0; i < op_starts.size(); i++) {
+			_ops_offsets.push_back(log_start + op_starts[i]);
+		}
+		_ops.put_bytes(ops.ptr() + body_start, reader.get_position() - body_start);
+	}
+	ops_sequence += count;
+	_flag_contents_changed = true;
+	_call_events(old_amount);
+	return true;
+}
+
 Dictionary Inventory::serialize() const {
+	// Inventories that were never touched since a lazy load are saved back untouched.
+	if (_has_pending_data)
+		return _pending_data;
 	Dictionary data = Dictionary();
-	data["items"] = get_database()->serialize_item_stacks(stacks);
+	data["items"] = get_database()->serialize_item_stacks(stacks, get_database()->get_compact_stack_properties());
 	return data;
 }
 
 void Inventory::deserialize(const Dictionary data) {
+	_record_reset_op(data);
+	if (_defer_deserialize(data))
+		return;
+	_deserialize_stacks(data);
+}
+
+Ref<InventorySnapshot> Inventory::capture_snapshot() const {
+	Ref<InventorySnapshot> snapshot;
+	snapshot.instantiate();
+	if (_has_pending_data) {
+		snapshot->set_data(_pending_data);
+		return snapshot;
+	}
+	_fill_snapshot(snapshot.ptr());
+	return snapshot;
+}
+
+void Inventory::_fill_snapshot(InventorySnapshot *snapshot) const {
+	ERR_FAIL_NULL_MSG(get_database(), "'database' is null.");
+	snapshot->capture_stacks(stacks, get_database());
+}
+
+void Inventory::_restore_snapshot(const InventorySnapshot *snapshot) {
+	_pending_data = Dictionary();
+	_has_pending_data = false;
+	// Existing stack objects are reused, so restoring allocates nothing in the
+	// common case where the stack count did not change.
+	int stack_count = snapshot->get_stack_count();
+	for (int i = 0; i < stack_count; i++) {
+		Ref<ItemStack> stack;
+		if (i < stacks.size())
+			stack = stacks[i];
+		if (stack == nullptr) {
+			stack.instantiate();
+			if (i < stacks.size())
+				stacks[i] = stack;
+			else
+				stacks.append(stack);
+		}
+		Dictionary properties = snapshot->get_properties(i);
+		stack->restore(snapshot->get_item_id(i), snapshot->get_amount(i), properties.is_empty() ? Dictionary() : properties.duplicate());
+	}
+	stacks.resize(stack_count);
+}
+
+int Inventory::_find_rollback(const int64_t tick) const {
+	for (int i = 0; i < _rollback_count; i++) {
+		int slot = (_rollback_start + i) % rollback_capacity;
+		if (_rollback_ticks[slot] == tick)
+			return i;
+	}
+	return -1;
+}
+
+void Inventory::set_rollback_capacity(const int &new_rollback_capacity) {
+	ERR_FAIL_COND_MSG(new_rollback_capacity < 0, "'rollback_capacity' can't be negative.");
+	rollback_capacity = new_rollback_capacity;
+	_rollback_snapshots.resize(rollback_capacity);
+	_rollback_ticks.resize(rollback_capacity);
+	clear_rollback();
+}
+
+int Inventory::get_rollback_capacity() const {
+	return rollback_capacity;
+}
+
+void Inventory::capture_rollback(const int64_t tick) {
+	ERR_FAIL_COND_MSG(rollback_capacity <= 0, "'rollback_capacity' must be greater than 0 to capture rollback snapshots.");
+	_ensure_loaded();
+	// Ticks at or after this one belong to a timeline that is being resimulated.
+	while (_rollback_count > 0 && _rollback_ticks[(_rollback_start + _rollback_count - 1) % rollback_capacity] >= tick)
+		_rollback_count--;
+	int slot;
+	if (_rollback_count < rollback_capacity) {
+		slot = (_rollback_start + _rollback_count) % rollback_capacity;
+		_rollback_count++;
+	} else {
+		slot = _rollback_start;
+		_rollback_start = (_rollback_start + 1) % rollback_capacity;
+	}
+	// Snapshots in the ring are refilled in place, keeping their buffers.
+	if (_rollback_snapshots[slot] == nullptr)
+		_rollback_snapshots[slot].instantiate();
+	_fill_snapshot(_rollback_snapshots[slot].ptr());
+	_rollback_ticks[slot] = tick;
+}
+
+bool Inventory::restore_rollback(const int64_t tick) {
+	int index = _find_rollback(tick);
+	ERR_FAIL_COND_V_MSG(index < 0, false, vformat("No rollback snapshot for tick %d.", tick));
+	int slot = (_rollback_start + index) % rollback_capacity;
+	_restore_snapshot(_rollback_snapshots[slot].ptr());
+	// Later snapshots are discarded, the next ticks will be captured again.
+	_rollback_count = index + 1;
+	_flag_contents_changed = true;
+	if (_is_recording_ops())
+		_record_reset_op(serialize());
+	return true;
+}
+
+bool Inventory::has_rollback(const int64_t tick) const {
+	return _find_rollback(tick) >= 0;
+}
+
+void Inventory::clear_rollback() {
+	_rollback_start = 0;
+	_rollback_count = 0;
+}
+
+PackedByteArray Inventory::serialize_compressed(const int compression_mode) const {
+	ERR_FAIL_NULL_V_MSG(get_database(), PackedByteArray(), "'database' is null.");
+	return get_database()->compress_data(serialize(), compression_mode);
+}
+
+void Inventory::deserialize_compressed(const PackedByteArray &data) {
+	ERR_FAIL_NULL_MSG(get_database(), "'database' is null.");
+	Variant decompressed = get_database()->decompress_data(data);
+	ERR_FAIL_COND_MSG(decompressed.get_type() != Variant::DICTIONARY, "Data to deserialize is invalid: Could not be decompressed.");
+	deserialize(decompressed);
+}
+
+void Inventory::_deserialize_stacks(const Dictionary &data) {
 	ERR_FAIL_COND_MSG(!data.has("items"), "Data to deserialize is invalid: Does not contain the 'items' field");
 	Array items_data = data["items"];
 	get_database()->deserialize_item_stacks(stacks, items_data);
@@ -467,6 +853,7 @@ bool Inventory::drop(const String &item_id, const int &amount, const Dictionary
 }
 
 void Inventory::drop_all_stacks() {
+	_ensure_loaded();
 	for (int i = stacks.size() - 1; i >= 0; i--) {
 		Ref<ItemStack> stack = stacks[i];
 		drop_from_inventory(i, stack->get_amount(), stack->get_properties());
@@ -474,6 +861,8 @@ void Inventory::drop_all_stacks() {
 }
 
 void Inventory::drop_from_inventory(const int &stack_index, const int &amount, const Dictionary &properties) {
+	_ensure_loaded();
+
 	ERR_FAIL_COND(stack_index < 0 || stack_index >= stacks.size());
 
 	if (stacks.size() <= stack_index)
@@ -564,6 +953,7 @@ void Inventory::_insert_stack(int stack_index) {
 	stack->set_item_id("");
 	stack->set_amount(0);
 	stacks.insert(stack_index, stack);
+	_record_stack_op(OP_INSERT, stack_index);
 	on_insert_stack(stack_index);
 	this->emit_signal("stack_added", stack_index);
 }
@@ -573,10 +963,41 @@ void Inventory::_remove_stack_at(int stack_index) {
 
 	Ref<ItemStack> stack_removed = stacks[stack_index];
 	stacks.remove_at(stack_index);
+	if (_is_recording_ops())
+		_begin_op(OP_REMOVE, stack_index);
 	on_removed_stack(stack_removed, stack_index);
 	this->emit_signal("stack_removed", stack_index);
 }
 
+void Inventory::_detach_stack(const int stack_index) {
+	Ref<ItemStack> stack = stacks[stack_index];
+	int old_amount = this->amount();
+	_remove_stack_at(stack_index);
+	emit_signal("item_removed", stack->get_item_id(), stack->get_amount());
+	_call_events(old_amount);
+}
+
+void Inventory::_attach_stack(const Ref<ItemStack> &stack) {
+	int old_amount = this->amount();
+	stacks.append(stack);
+	int stack_index = stacks.size() - 1;
+	_record_stack_op(OP_INSERT, stack_index);
+	on_insert_stack(stack_index);
+	emit_signal("stack_added", stack_index);
+	_call_events(old_amount);
+}
+
+bool Inventory::_can_replace_stack(const int stack_index, const String &item_id, const int amount, const Dictionary &properties) {
+	// Constraints see the inventory without the outgoing stack, as they would
+	// if it were removed before the new one is added.
+	ERR_FAIL_COND_V_MSG(stack_index < 0 || stack_index >= stacks.size(), false, "The 'stack index' is out of bounds.");
+	Ref<ItemStack> outgoing = stacks[stack_index];
+	stacks.remove_at(stack_index);
+	bool can_add = Inventory::can_add_new_stack(item_id, amount, properties);
+	stacks.insert(stack_index, outgoing);
+	return can_add;
+}
+
 void Inventory::_call_events(int old_amount) {
 	int actual_amount = amount();
 	if (old_amount != actual_amount) {
@@ -597,12 +1018,20 @@ int Inventory::_add_to_stack(int stack_index, const String &item_id, int amount,
 	Ref<ItemStack> stack = stacks[stack_index];
 	ERR_FAIL_NULL_V_MSG(stack, amount, "The 'stack' is null.");
 
+	bool was_valid = stack->has_valid();
 	int _remaining_amount = add_to_stack(stack, item_id, amount, properties);
 
 	if (_remaining_amount == amount) {
 		return amount;
 	}
 
+	if (was_valid) {
+		if (_is_recording_ops())
+			_begin_op(OP_AMOUNT, stack_index).put_zigzag(amount - _remaining_amount);
+	} else {
+		_record_stack_op(OP_SET, stack_index);
+	}
+
 	emit_signal("updated_stack", stack_index);
 	return _remaining_amount;
 }
@@ -616,6 +1045,8 @@ int Inventory::_remove_from_stack(int stack_index, const String &item_id, int am
 	if (_remaining_amount == amount) {
 		return amount;
 	}
+	if (_is_recording_ops())
+		_begin_op(OP_AMOUNT, stack_index).put_zigzag(_remaining_amount - amount);
 	emit_signal("updated_stack", stack_index);
 	return _remaining_amount;
 }
@@ -683,6 +1114,105 @@ bool Inventory::_is_override_max_stack_from_constraints(const String item_id, co
 	return false;
 }
 
+bool Inventory::_defer_deserialize(const Dictionary &data) {
+	if (!lazy_deserialize || _loading_pending_data)
+		return false;
+	_pending_data = data;
+	_has_pending_data = true;
+	return true;
+}
+
+bool Inventory::_is_recording_ops() const {
+	return (record_ops || !_ops_listeners.is_empty()) && !_applying_ops;
+}
+
+ByteWriter &Inventory::_begin_op(const OpType op, const int stack_index) {
+	_ops_offsets.push_back(_ops.size());
+	ops_sequence += 1;
+	_ops.put_u8(op);
+	_ops.put_varint(stack_index);
+	return _ops;
+}
+
+void Inventory::_record_stack_op(const OpType op, const int stack_index) {
+	if (!_is_recording_ops())
+		return;
+	ERR_FAIL_NULL_MSG(get_database(), "'database' is null.");
+	Ref<ItemStack> stack = stacks[stack_index];
+	ByteWriter &writer = _begin_op(op, stack_index);
+	writer.put_string(stack->get_item_id());
+	writer.put_zigzag(stack->get_amount());
+	writer.put_buffer(get_database()->serialize_stack_properties(stack->get_item_id(), stack->get_properties()));
+}
+
+void Inventory::_record_reset_op(const Dictionary &data) {
+	// Loads of a deferred payload were already recorded when it was received.
+	if (!_is_recording_ops() || _loading_pending_data)
+		return;
+	_begin_op(OP_RESET, 0).put_variant(data);
+}
+
+bool Inventory::_apply_op(const int op, const int stack_index, ByteReader &reader) {
+	ERR_FAIL_NULL_V_MSG(get_database(), false, "'database' is null.");
+	switch (op) {
+		case OP_INSERT:
+		case OP_SET: {
+			String item_id = reader.get_string();
+			int amount = reader.get_zigzag();
+			Dictionary properties = get_database()->deserialize_stack_properties(item_id, reader.get_buffer(reader.get_varint()));
+			if (op == OP_SET) {
+				ERR_FAIL_INDEX_V(stack_index, stacks.size(), false);
+				Ref<ItemStack> stack = stacks[stack_index];
+				stack->set_item_id(item_id);
+				stack->set_amount(amount);
+				stack->set_properties(properties);
+				emit_signal("updated_stack", stack_index);
+				return true;
+			}
+			ERR_FAIL_COND_V(stack_index < 0 || stack_index > stacks.size(), false);
+			Ref<ItemStack> stack = memnew(ItemStack());
+			stack->set_item_id(item_id);
+			stack->set_amount(amount);
+			stack->set_properties(properties);
+			stacks.insert(stack_index, stack);
+			on_insert_stack(stack_index);
+			emit_signal("stack_added", stack_index);
+			return true;
+		}
+		case OP_REMOVE:
+			ERR_FAIL_INDEX_V(stack_index, stacks.size(), false);
+			_remove_stack_at(stack_index);
+			return true;
+		case OP_AMOUNT: {
+			ERR_FAIL_INDEX_V(stack_index, stacks.size(), false);
+			Ref<ItemStack> stack = stacks[stack_index];
+			stack->set_amount(stack->get_amount() + reader.get_zigzag());
+			emit_signal("updated_stack", stack_index);
+			return true;
+		}
+		case OP_RESET: {
+			Dictionary data = reader.get_variant();
+			deserialize(data);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+void Inventory::_ensure_loaded() const {
+	if (!_has_pending_data)
+		return;
+	// Stacks are built from the saved payload on the first query or mutation.
+	Inventory *self = const_cast<Inventory *>(this);
+	Dictionary data = self->_pending_data;
+	self->_pending_data = Dictionary();
+	self->_has_pending_data = false;
+	self->_loading_pending_data = true;
+	self->deserialize(data);
+	self->_loading_pending_data = false;
+}
+
 bool Inventory::_can_swap_to_inventory(const Inventory *inventory, const String item_id, const int amount, const Dictionary properties) const {
 	int other_real_add = inventory->_get_amount_to_add_from_constraints(item_id, amount, properties);
 	int other_max_stack = inventory->_get_max_stack_for_stack(item_id, other_real_add, properties);
@@ -711,8 +1241,10 @@ void Inventory::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("remove_at", "stack_index", "item_id", "amount"), &Inventory::remove_at, DEFVAL(1));
 	ClassDB::bind_method(D_METHOD("remove_stack", "stack_index"), &Inventory::remove_stack);
 	ClassDB::bind_method(D_METHOD("split", "stack_index", "amount"), &Inventory::split, DEFVAL(1));
+	ClassDB::bind_method(D_METHOD("defragment"), &Inventory::defragment);
 	ClassDB::bind_method(D_METHOD("transfer_at", "stack_index", "destination", "destination_stack_index", "amount"), &Inventory::transfer_at, DEFVAL(1));
 	ClassDB::bind_method(D_METHOD("transfer", "stack_index", "destination", "amount"), &Inventory::transfer, DEFVAL(1));
+	ClassDB::bind_method(D_METHOD("transfer_stack", "stack_index", "destination"), &Inventory::transfer_stack);
 	ClassDB::bind_method(D_METHOD("drop", "item_id", "amount", "properties"), &Inventory::drop, DEFVAL(1), DEFVAL(Dictionary()));
 	ClassDB::bind_method(D_METHOD("drop_all_stacks"), &Inventory::drop_all_stacks);
 	ClassDB::bind_method(D_METHOD("drop_from_inventory", "stack_index", "amount", "properties"), &Inventory::drop_from_inventory, DEFVAL(1), DEFVAL(Dictionary()));
@@ -722,6 +1254,9 @@ void Inventory::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("contains_category_in_stack", "stack", "category"), &Inventory::contains_category_in_stack);
 	ClassDB::bind_method(D_METHOD("serialize"), &Inventory::serialize);
 	ClassDB::bind_method(D_METHOD("deserialize", "data"), &Inventory::deserialize);
+	ClassDB::bind_method(D_METHOD("capture_snapshot"), &Inventory::capture_snapshot);
+	ClassDB::bind_method(D_METHOD("serialize_compressed", "compression_mode"), &Inventory::serialize_compressed, DEFVAL(FileAccess::COMPRESSION_ZSTD));
+	ClassDB::bind_method(D_METHOD("deserialize_compressed", "data"), &Inventory::deserialize_compressed);
 	ClassDB::bind_method(D_METHOD("can_add_new_stack", "item_id", "amount", "properties"), &Inventory::can_add_new_stack, DEFVAL(1), DEFVAL(Dictionary()));
 
 	ClassDB::bind_method(D_METHOD("set_stacks", "stacks"), &Inventory::set_stacks);
@@ -731,6 +1266,24 @@ void Inventory::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_constraints", "constraints"), &Inventory::set_constraints);
 	ClassDB::bind_method(D_METHOD("get_constraints"), &Inventory::get_constraints);
 	ClassDB::bind_method(D_METHOD("update_stack", "stack_index"), &Inventory::update_stack);
+	ClassDB::bind_method(D_METHOD("set_lazy_deserialize", "lazy_deserialize"), &Inventory::set_lazy_deserialize);
+	ClassDB::bind_method(D_METHOD("get_lazy_deserialize"), &Inventory::get_lazy_deserialize);
+	ClassDB::bind_method(D_METHOD("has_pending_data"), &Inventory::has_pending_data);
+	ClassDB::bind_method(D_METHOD("set_rollback_capacity", "rollback_capacity"), &Inventory::set_rollback_capacity);
+	ClassDB::bind_method(D_METHOD("get_rollback_capacity"), &Inventory::get_rollback_capacity);
+	ClassDB::bind_method(D_METHOD("capture_rollback", "tick"), &Inventory::capture_rollback);
+	ClassDB::bind_method(D_METHOD("restore_rollback", "tick"), &Inventory::restore_rollback);
+	ClassDB::bind_method(D_METHOD("has_rollback", "tick"), &Inventory::has_rollback);
+	ClassDB::bind_method(D_METHOD("clear_rollback"), &Inventory::clear_rollback);
+	ClassDB::bind_method(D_METHOD("set_record_ops", "record_ops"), &Inventory::set_record_ops);
+	ClassDB::bind_method(D_METHOD("get_record_ops"), &Inventory::get_record_ops);
+	ClassDB::bind_method(D_METHOD("set_ops_sequence", "ops_sequence"), &Inventory::set_ops_sequence);
+	ClassDB::bind_method(D_METHOD("get_ops_sequence"), &Inventory::get_ops_sequence);
+	ClassDB::bind_method(D_METHOD("take_ops"), &Inventory::take_ops);
+	ClassDB::bind_method(D_METHOD("add_ops_listener"), &Inventory::add_ops_listener);
+	ClassDB::bind_method(D_METHOD("remove_ops_listener", "listener_id"), &Inventory::remove_ops_listener);
+	ClassDB::bind_method(D_METHOD("take_listener_ops", "listener_id"), &Inventory::take_listener_ops);
+	ClassDB::bind_method(D_METHOD("apply_ops", "ops"), &Inventory::apply_ops);
 	ADD_SIGNAL(MethodInfo("contents_changed"));
 	ADD_SIGNAL(MethodInfo("stack_added", PropertyInfo(Variant::INT, "stack_index")));
 	ADD_SIGNAL(MethodInfo("stack_removed", PropertyInfo(Variant::INT, "stack_index")));
@@ -745,9 +1298,16 @@ void Inventory::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "stacks", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "ItemStack")), "set_stacks", "get_stacks");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "inventory_name"), "set_inventory_name", "get_inventory_name");
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "constraints", PROPERTY_HINT_ARRAY_TYPE, vformat("%s/%s:%s", Variant::OBJECT, PROPERTY_HINT_RESOURCE_TYPE, "InventoryConstraint")), "set_constraints", "get_constraints");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "lazy_deserialize"), "set_lazy_deserialize", "get_lazy_deserialize");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "rollback_capacity", PROPERTY_HINT_RANGE, "0,1024,1,or_greater"), "set_rollback_capacity", "get_rollback_capacity");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "record_ops"), "set_record_ops", "get_record_ops");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "ops_sequence", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_ops_sequence", "get_ops_sequence");
 }
 
 void Inventory::update_stack(const int stack_index) {
+	_ensure_loaded();
+	if (stack_index >= 0 && stack_index < stacks.size())
+		_record_stack_op(OP_SET, stack_index);
 	emit_signal("updated_stack", stack_index);
 	_call_events(amount());
 }
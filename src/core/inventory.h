@@ -1,9 +1,12 @@
 #ifndef INVENTORY_CLASS_H
 #define INVENTORY_CLASS_H
 
+#include "base/byte_stream.h"
 #include "base/item_stack.h"
 #include "base/node_inventories.h"
 #include "constraints/inventory_constraint.h"
+#include "core/inventory_snapshot.h"
+#include <godot_cpp/templates/hash_map.hpp>
 
 using namespace godot;
 
@@ -14,14 +17,41 @@ private:
 	int max_size = 16;
 	String inventory_name = "Inventory";
 	TypedArray<InventoryConstraint> constraints;
+	bool lazy_deserialize = false;
+	Dictionary _pending_data;
+	bool _has_pending_data = false;
+	bool _loading_pending_data = false;
+	bool record_ops = false;
+	int64_t ops_sequence = 0;
+	ByteWriter _ops;
+	LocalVector<int64_t> _ops_offsets;
+	int64_t _ops_cursor = 0;
+	HashMap<int64_t, int64_t> _ops_listeners;
+	int64_t _next_ops_listener = 1;
+	int rollback_capacity = 0;
+	LocalVector<Ref<InventorySnapshot>> _rollback_snapshots;
+	LocalVector<int64_t> _rollback_ticks;
+	int _rollback_start = 0;
+	int _rollback_count = 0;
+	int _find_rollback(const int64_t tick) const;
 	void _insert_stack(int stack_index);
 	void _remove_stack_at(int stack_index);
-	void _call_events(int old_amount);
-	int _add_to_stack(int stack_index, const String &item_id, int amount = 1, const Dictionary &properties = Dictionary());
 	int _remove_from_stack(int stack_index, const String &item_id, int amount = 1);
+	PackedByteArray _take_ops_from(int64_t &cursor);
+	void _trim_ops();
 
 protected:
+	enum OpType {
+		OP_INSERT,
+		OP_REMOVE,
+		OP_AMOUNT,
+		OP_SET,
+		OP_RESET,
+		OP_MOVE,
+		OP_ROTATE,
+	};
 	bool _flag_contents_changed = false;
+	bool _applying_ops = false;
 	TypedArray<ItemStack> stacks;
 	static void _bind_methods();
 	int _get_max_stack_for_stack(const String item_id, const int amount, const Dictionary properties) const;
@@ -31,6 +61,22 @@ protected:
 	int _get_amount_to_add_from_constraints(const String item_id, const int amount, const Dictionary properties) const;
 	bool _is_override_max_stack_from_constraints(const String item_id, const int amount, const Dictionary properties) const;
 	bool _can_swap_to_inventory(const Inventory *inventory, const String item_id, const int amount, const Dictionary properties) const;
+	bool _defer_deserialize(const Dictionary &data);
+	void _ensure_loaded() const;
+	bool _is_recording_ops() const;
+	ByteWriter &_begin_op(const OpType op, const int stack_index);
+	void _record_stack_op(const OpType op, const int stack_index);
+	void _record_reset_op(const Dictionary &data);
+	void _deserialize_stacks(const Dictionary &data);
+	bool _merge_stacks(int &removed);
+	void _call_events(int old_amount);
+	int _add_to_stack(int stack_index, const String &item_id, int amount = 1, const Dictionary &properties = Dictionary());
+	void _detach_stack(const int stack_index);
+	void _attach_stack(const Ref<ItemStack> &stack);
+	bool _can_replace_stack(const int stack_index, const String &item_id, const int amount, const Dictionary &properties);
+	virtual bool _apply_op(const int op, const int stack_index, ByteReader &reader);
+	virtual void _fill_snapshot(InventorySnapshot *snapshot) const;
+	virtual void _restore_snapshot(const InventorySnapshot *snapshot);
 
 public:
 	Inventory();
@@ -60,8 +106,10 @@ public:
 	int remove(const String &item_id, const int &amount = 1);
 	int remove_at(const int &stack_index, const String &item_id, const int &amount = 1);
 	bool split(const int &stack_index, const int &amount = 1);
+	virtual int defragment();
 	int transfer_at(const int &stack_index, Inventory *destination, const int &destination_stack_index, const int &amount = 1);
 	int transfer(const int &stack_index, Inventory *destination, const int &amount = 1);
+	bool transfer_stack(const int &stack_index, Inventory *destination);
 	virtual bool drop(const String &item_id, const int &amount, const Dictionary &properties);
 	void drop_all_stacks();
 	void drop_from_inventory(const int &stack_index, const int &amount = 1, const Dictionary &properties = Dictionary());
@@ -70,14 +118,35 @@ public:
 	bool is_accept_any_categories(const int categories_flag, const TypedArray<ItemCategory> &categories) const;
 	int get_max_stack_of_stack(const Ref<ItemStack> &stack, Ref<ItemDefinition> &item) const;
 	bool contains_category_in_stack(const Ref<ItemStack> &slot, const Ref<ItemCategory> &category) const;
-	void set_stacks(const TypedArray<ItemStack> &new_items);
+	virtual void set_stacks(const TypedArray<ItemStack> &new_items);
 	TypedArray<ItemStack> get_stacks() const;
 	void set_inventory_name(const String &new_inventory_name);
 	String get_inventory_name() const;
 	void set_constraints(const TypedArray<InventoryConstraint> &new_constraints);
 	TypedArray<InventoryConstraint> get_constraints() const;
+	void set_lazy_deserialize(const bool &new_lazy_deserialize);
+	bool get_lazy_deserialize() const;
+	bool has_pending_data() const;
+	void set_record_ops(const bool &new_record_ops);
+	bool get_record_ops() const;
+	void set_ops_sequence(const int64_t &new_ops_sequence);
+	int64_t get_ops_sequence() const;
+	PackedByteArray take_ops();
+	int64_t add_ops_listener();
+	void remove_ops_listener(const int64_t listener_id);
+	PackedByteArray take_listener_ops(const int64_t listener_id);
+	void set_rollback_capacity(const int &new_rollback_capacity);
+	int get_rollback_capacity() const;
+	void capture_rollback(const int64_t tick);
+	bool restore_rollback(const int64_t tick);
+	bool has_rollback(const int64_t tick) const;
+	void clear_rollback();
+	bool apply_ops(const PackedByteArray &ops);
 	virtual Dictionary serialize() const;
 	virtual void deserialize(const Dictionary data);
+	Ref<InventorySnapshot> capture_snapshot() const;
+	PackedByteArray serialize_compressed(const int compression_mode = FileAccess::COMPRESSION_ZSTD) const;
+	void deserialize_compressed(const PackedByteArray &data);
 	virtual bool can_add_new_stack(const String &item_id, const int &amount = 1, const Dictionary &properties = Dictionary()) const;
 	virtual void on_insert_stack(const int stack_index);
 	virtual void on_removed_stack(const Ref<ItemStack> stack, const int stack_index);
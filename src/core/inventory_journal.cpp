@@ -0,0 +1,255 @@
+#include "inventory_journal.h"
+#include <godot_cpp/classes/dir_access.hpp>
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/core/object.hpp>
+
+// Each journal record is [payload size: u32][checksum: u32][payload], where the
+// payload is an op stream taken through the journal's own ops listener, so other
+// consumers of Inventory::take_ops() keep receiving every op.
+
+void InventoryJournal::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_inventory_path", "inventory"), &InventoryJournal::set_inventory_path);
+	ClassDB::bind_method(D_METHOD("get_inventory_path"), &InventoryJournal::get_inventory_path);
+	ClassDB::bind_method(D_METHOD("get_inventory"), &InventoryJournal::get_inventory);
+	ClassDB::bind_method(D_METHOD("set_file_path", "file_path"), &InventoryJournal::set_file_path);
+	ClassDB::bind_method(D_METHOD("get_file_path"), &InventoryJournal::get_file_path);
+	ClassDB::bind_method(D_METHOD("set_compact_threshold", "compact_threshold"), &InventoryJournal::set_compact_threshold);
+	ClassDB::bind_method(D_METHOD("get_compact_threshold"), &InventoryJournal::get_compact_threshold);
+	ClassDB::bind_method(D_METHOD("set_flush_interval", "flush_interval"), &InventoryJournal::set_flush_interval);
+	ClassDB::bind_method(D_METHOD("get_flush_interval"), &InventoryJournal::get_flush_interval);
+	ClassDB::bind_method(D_METHOD("flush"), &InventoryJournal::flush);
+	ClassDB::bind_method(D_METHOD("compact"), &InventoryJournal::compact);
+	ClassDB::bind_method(D_METHOD("recover"), &InventoryJournal::recover);
+
+	ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "inventory", PROPERTY_HINT_NODE_PATH_VALID_TYPES, "Inventory"), "set_inventory_path", "get_inventory_path");
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "file_path", PROPERTY_HINT_FILE), "set_file_path", "get_file_path");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "compact_threshold"), "set_compact_threshold", "get_compact_threshold");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "flush_interval"), "set_flush_interval", "get_flush_interval");
+}
+
+InventoryJournal::InventoryJournal() {
+}
+
+InventoryJournal::~InventoryJournal() {
+}
+
+void InventoryJournal::_ready() {
+	if (Engine::get_singleton()->is_editor_hint())
+		return;
+	Inventory *inventory = get_inventory();
+	if (inventory == nullptr)
+		return;
+	_get_ops_listener(inventory);
+}
+
+void InventoryJournal::_exit_tree() {
+	_release_ops_listener();
+}
+
+void InventoryJournal::_process(double delta) {
+	if (Engine::get_singleton()->is_editor_hint())
+		return;
+	if (flush_interval <= 0 || inventory_path.is_empty())
+		return;
+	_time_since_flush += delta;
+	if (_time_since_flush < flush_interval)
+		return;
+	_time_since_flush = 0.0;
+	flush();
+}
+
+void InventoryJournal::set_inventory_path(const NodePath &new_inventory_path) {
+	inventory_path = new_inventory_path;
+}
+
+NodePath InventoryJournal::get_inventory_path() const {
+	return inventory_path;
+}
+
+Inventory *InventoryJournal::get_inventory() const {
+	Node *node_inv = get_node_or_null(inventory_path);
+	Inventory *inventory = Object::cast_to<Inventory>(node_inv);
+	if (node_inv == nullptr) {
+		ERR_PRINT("Missing setup inventory node on journal.");
+		return nullptr;
+	}
+	if (!inventory) {
+		ERR_PRINT("Inventory param must be 'Inventory' Node");
+		return nullptr;
+	}
+	return inventory;
+}
+
+void InventoryJournal::set_file_path(const String &new_file_path) {
+	file_path = new_file_path;
+}
+
+String InventoryJournal::get_file_path() const {
+	return file_path;
+}
+
+void InventoryJournal::set_compact_threshold(const int &new_compact_threshold) {
+	compact_threshold = new_compact_threshold;
+}
+
+int InventoryJournal::get_compact_threshold() const {
+	return compact_threshold;
+}
+
+void InventoryJournal::set_flush_interval(const float &new_flush_interval) {
+	flush_interval = new_flush_interval;
+}
+
+float InventoryJournal::get_flush_interval() const {
+	return flush_interval;
+}
+
+bool InventoryJournal::_has_ops_listener(const Inventory *inventory) const {
+	return _ops_listener != -1 && _ops_inventory_id == inventory->get_instance_id();
+}
+
+int64_t InventoryJournal::_get_ops_listener(Inventory *inventory) {
+	if (_has_ops_listener(inventory))
+		return _ops_listener;
+	_release_ops_listener();
+	_ops_inventory_id = inventory->get_instance_id();
+	_ops_listener = inventory->add_ops_listener();
+	return _ops_listener;
+}
+
+void InventoryJournal::_release_ops_listener() {
+	if (_ops_listener == -1)
+		return;
+	Inventory *inventory = Object::cast_to<Inventory>(ObjectDB::get_instance(_ops_inventory_id));
+	if (inventory != nullptr)
+		inventory->remove_ops_listener(_ops_listener);
+	_ops_listener = -1;
+}
+
+String InventoryJournal::_get_journal_path() const {
+	return file_path + ".journal";
+}
+
+uint32_t InventoryJournal::_checksum(const PackedByteArray &data) {
+	// FNV-1a, enough to detect a torn or partially written tail.
+	uint32_t hash = 2166136261u;
+	const uint8_t *ptr = data.ptr();
+	for (int64_t i = 0; i < data.size(); i++) {
+		hash = (hash ^ ptr[i]) * 16777619u;
+	}
+	return hash;
+}
+
+Error InventoryJournal::flush() {
+	Inventory *inventory = get_inventory();
+	ERR_FAIL_NULL_V_MSG(inventory, ERR_UNCONFIGURED, "'inventory' is null.");
+	ERR_FAIL_COND_V_MSG(file_path.is_empty(), ERR_INVALID_PARAMETER, "'file_path' is empty.");
+
+	// Journal records only make sense on top of a snapshot, and a new listener
+	// has missed whatever happened before it was added.
+	if (!FileAccess::file_exists(file_path) || !_has_ops_listener(inventory))
+		return compact();
+
+	PackedByteArray ops = inventory->take_listener_ops(_ops_listener);
+	if (ops.is_empty())
+		return OK;
+
+	String journal_path = _get_journal_path();
+	Ref<FileAccess> file = FileAccess::open(journal_path, FileAccess::READ_WRITE);
+	if (file == nullptr)
+		file = FileAccess::open(journal_path, FileAccess::WRITE);
+	if (file == nullptr) {
+		// The taken ops are gone, so the snapshot has to catch up instead.
+		return compact();
+	}
+	file->seek_end();
+	ByteWriter header;
+	header.put_u32(ops.size());
+	header.put_u32(_checksum(ops));
+	file->store_buffer(header.to_packed());
+	file->store_buffer(ops);
+	uint64_t journal_size = file->get_length();
+	file->close();
+
+	if (compact_threshold > 0 && journal_size >= uint64_t(compact_threshold))
+		return compact();
+	return OK;
+}
+
+Error InventoryJournal::compact() {
+	Inventory *inventory = get_inventory();
+	ERR_FAIL_NULL_V_MSG(inventory, ERR_UNCONFIGURED, "'inventory' is null.");
+	ERR_FAIL_NULL_V_MSG(inventory->get_database(), ERR_UNCONFIGURED, "'database' is null.");
+	ERR_FAIL_COND_V_MSG(file_path.is_empty(), ERR_INVALID_PARAMETER, "'file_path' is empty.");
+
+	// Pending ops are already part of the state captured below.
+	inventory->take_listener_ops(_get_ops_listener(inventory));
+	Dictionary snapshot = Dictionary();
+	snapshot["inventory"] = inventory->serialize();
+	snapshot["ops_sequence"] = inventory->get_ops_sequence();
+	PackedByteArray data = inventory->get_database()->compress_data(snapshot);
+
+	// Write aside and rename, so a crash never leaves a half-written snapshot.
+	String temp_path = file_path + ".tmp";
+	Ref<FileAccess> file = FileAccess::open(temp_path, FileAccess::WRITE);
+	if (file == nullptr)
+		return FileAccess::get_open_error();
+	file->store_buffer(data);
+	file->close();
+	Error error = DirAccess::rename_absolute(temp_path, file_path);
+	ERR_FAIL_COND_V_MSG(error != OK, error, "Could not replace the inventory snapshot.");
+
+	// Records left behind by a crash before this point are skipped on recovery,
+	// since their sequence is older than the snapshot.
+	Ref<FileAccess> journal = FileAccess::open(_get_journal_path(), FileAccess::WRITE);
+	if (journal == nullptr)
+		return FileAccess::get_open_error();
+	journal->close();
+	return OK;
+}
+
+Error InventoryJournal::recover() {
+	Inventory *inventory = get_inventory();
+	ERR_FAIL_NULL_V_MSG(inventory, ERR_UNCONFIGURED, "'inventory' is null.");
+	ERR_FAIL_NULL_V_MSG(inventory->get_database(), ERR_UNCONFIGURED, "'database' is null.");
+	if (!FileAccess::file_exists(file_path))
+		return ERR_FILE_NOT_FOUND;
+
+	Ref<FileAccess> file = FileAccess::open(file_path, FileAccess::READ);
+	if (file == nullptr)
+		return FileAccess::get_open_error();
+	Variant snapshot_data = inventory->get_database()->decompress_data(file->get_buffer(file->get_length()));
+	file->close();
+	ERR_FAIL_COND_V_MSG(snapshot_data.get_type() != Variant::DICTIONARY, ERR_FILE_CORRUPT, "Inventory snapshot is corrupt.");
+	Dictionary snapshot = snapshot_data;
+	inventory->deserialize(snapshot["inventory"]);
+	// Renumbering also drops the reset op recorded by deserialize().
+	inventory->set_ops_sequence(snapshot["ops_sequence"]);
+	_get_ops_listener(inventory);
+
+	Ref<FileAccess> journal = FileAccess::open(_get_journal_path(), FileAccess::READ);
+	if (journal != nullptr) {
+		PackedByteArray journal_data = journal->get_buffer(journal->get_length());
+		journal->close();
+		ByteReader reader = ByteReader(journal_data);
+		while (!reader.is_at_end()) {
+			uint32_t size = reader.get_u32();
+			uint32_t checksum = reader.get_u32();
+			PackedByteArray ops = reader.get_buffer(size);
+			// Stop at the first torn or corrupt record; everything after it is lost.
+			if (reader.has_error() || _checksum(ops) != checksum)
+				break;
+			ByteReader ops_header = ByteReader(ops);
+			int64_t sequence = ops_header.get_varint();
+			int64_t count = ops_header.get_varint();
+			if (sequence + count <= inventory->get_ops_sequence())
+				continue;
+			if (sequence != inventory->get_ops_sequence() || !inventory->apply_ops(ops))
+				break;
+		}
+	}
+
+	// Fold the replayed tail into a fresh snapshot and drop anything unreadable.
+	return compact();
+}
@@ -0,0 +1,49 @@
+#ifndef INVENTORY_JOURNAL_CLASS_H
+#define INVENTORY_JOURNAL_CLASS_H
+
+#include "inventory.h"
+#include <godot_cpp/classes/node.hpp>
+
+using namespace godot;
+
+class InventoryJournal : public Node {
+	GDCLASS(InventoryJournal, Node);
+
+private:
+	NodePath inventory_path;
+	String file_path = "user://inventory.sav";
+	int compact_threshold = 65536;
+	float flush_interval = 1.0;
+	double _time_since_flush = 0.0;
+	uint64_t _ops_inventory_id = 0;
+	int64_t _ops_listener = -1;
+	bool _has_ops_listener(const Inventory *inventory) const;
+	int64_t _get_ops_listener(Inventory *inventory);
+	void _release_ops_listener();
+	String _get_journal_path() const;
+	static uint32_t _checksum(const PackedByteArray &data);
+
+protected:
+	static void _bind_methods();
+
+public:
+	InventoryJournal();
+	~InventoryJournal();
+	virtual void _ready() override;
+	virtual void _exit_tree() override;
+	virtual void _process(double delta) override;
+	void set_inventory_path(const NodePath &new_inventory_path);
+	NodePath get_inventory_path() const;
+	Inventory *get_inventory() const;
+	void set_file_path(const String &new_file_path);
+	String get_file_path() const;
+	void set_compact_threshold(const int &new_compact_threshold);
+	int get_compact_threshold() const;
+	void set_flush_interval(const float &new_flush_interval);
+	float get_flush_interval() const;
+	Error flush();
+	Error compact();
+	Error recover();
+};
+
+#endif // INVENTORY_JOURNAL_CLASS_H
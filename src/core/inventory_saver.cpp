@@ -0,0 +1,110 @@
+#include "inventory_saver.h"
+
+#include "core/inventory.h"
+#include "craft/craft_station.h"
+#include <godot_cpp/classes/dir_access.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+
+void InventorySaver::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_inventory", "key", "inventory"), &InventorySaver::add_inventory);
+	ClassDB::bind_method(D_METHOD("add_craft_station", "key", "craft_station"), &InventorySaver::add_craft_station);
+	ClassDB::bind_method(D_METHOD("clear"), &InventorySaver::clear);
+	ClassDB::bind_method(D_METHOD("is_saving"), &InventorySaver::is_saving);
+	ClassDB::bind_method(D_METHOD("save_async", "path", "compression_mode"), &InventorySaver::save_async, DEFVAL(FileAccess::COMPRESSION_ZSTD));
+	ClassDB::bind_static_method("InventorySaver", D_METHOD("load_data", "path", "database"), &InventorySaver::load_data);
+	ClassDB::bind_method(D_METHOD("_finish_save", "path", "error"), &InventorySaver::_finish_save);
+	ADD_SIGNAL(MethodInfo("save_completed", PropertyInfo(Variant::STRING, "path"), PropertyInfo(Variant::INT, "error")));
+}
+
+InventorySaver::InventorySaver() {
+}
+
+InventorySaver::~InventorySaver() {
+}
+
+void InventorySaver::_add_snapshot(const String &key, const Ref<InventorySnapshot> &snapshot, const Ref<InventoryDatabase> &snapshot_database) {
+	ERR_FAIL_NULL_MSG(snapshot_database, "'database' is null.");
+	ERR_FAIL_COND_MSG(database != nullptr && database != snapshot_database, "All saved nodes must share the same database.");
+	ERR_FAIL_COND_MSG(keys.has(key), vformat("Key '%s' was already added.", key));
+	database = snapshot_database;
+	keys.append(key);
+	snapshots.append(snapshot);
+}
+
+void InventorySaver::add_inventory(const String &key, Inventory *inventory) {
+	ERR_FAIL_NULL_MSG(inventory, "'inventory' is null.");
+	_add_snapshot(key, inventory->capture_snapshot(), inventory->get_database());
+}
+
+void InventorySaver::add_craft_station(const String &key, CraftStation *craft_station) {
+	ERR_FAIL_NULL_MSG(craft_station, "'craft_station' is null.");
+	_add_snapshot(key, craft_station->capture_snapshot(), craft_station->get_database());
+}
+
+void InventorySaver::clear() {
+	keys.clear();
+	snapshots.clear();
+	database.unref();
+}
+
+bool InventorySaver::is_saving() const {
+	return _saving;
+}
+
+Error InventorySaver::save_async(const String &path, const int compression_mode) {
+	ERR_FAIL_COND_V_MSG(_saving, ERR_BUSY, "A save is already in progress.");
+	ERR_FAIL_NULL_V_MSG(database, ERR_UNCONFIGURED, "Nothing was added to save.");
+	ERR_FAIL_COND_V_MSG(path.is_empty(), ERR_INVALID_PARAMETER, "'path' is empty.");
+
+	// Snapshots already hold their encoded properties and are never touched
+	// again on this thread, so the worker reads no node and no database.
+	_saving = true;
+	Callable task = callable_mp_static(&InventorySaver::_save_task).bind(Ref<InventorySaver>(this), keys, snapshots, path, compression_mode);
+	keys = PackedStringArray();
+	snapshots = TypedArray<InventorySnapshot>();
+	_save_task_id = WorkerThreadPool::get_singleton()->add_task(task);
+	return OK;
+}
+
+void InventorySaver::_save_task(const Ref<InventorySaver> &saver, const PackedStringArray &snapshot_keys, const TypedArray<InventorySnapshot> &snapshot_list, const String &path, const int compression_mode) {
+	Dictionary data = Dictionary();
+	for (int64_t i = 0; i < snapshot_list.size(); i++) {
+		Ref<InventorySnapshot> snapshot = snapshot_list[i];
+		data[snapshot_keys[i]] = snapshot->to_dictionary();
+	}
+	PackedByteArray bytes = InventoryDatabase::compress_variant(data, compression_mode);
+
+	// Write aside and rename, so a crash never leaves a half-written save.
+	Error error = OK;
+	String temp_path = path + ".tmp";
+	Ref<FileAccess> file = FileAccess::open(temp_path, FileAccess::WRITE);
+	if (file == nullptr) {
+		error = FileAccess::get_open_error();
+	} else {
+		file->store_buffer(bytes);
+		file->close();
+		error = DirAccess::rename_absolute(temp_path, path);
+	}
+	saver->call_deferred("_finish_save", path, error);
+}
+
+void InventorySaver::_finish_save(const String &path, const int error) {
+	// Pool tasks must be waited on to be released; this one is already done.
+	if (_save_task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_save_task_id);
+		_save_task_id = -1;
+	}
+	_saving = false;
+	emit_signal("save_completed", path, error);
+}
+
+Dictionary InventorySaver::load_data(const String &path, const Ref<InventoryDatabase> &load_database) {
+	ERR_FAIL_NULL_V_MSG(load_database, Dictionary(), "'database' is null.");
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+	ERR_FAIL_NULL_V_MSG(file, Dictionary(), vformat("Could not open '%s'.", path));
+	PackedByteArray bytes = file->get_buffer(file->get_length());
+	file->close();
+	Variant data = load_database->decompress_data(bytes);
+	ERR_FAIL_COND_V_MSG(data.get_type() != Variant::DICTIONARY, Dictionary(), "Save data is invalid: Could not be decompressed.");
+	return data;
+}
@@ -0,0 +1,40 @@
+#ifndef INVENTORY_SAVER_CLASS_H
+#define INVENTORY_SAVER_CLASS_H
+
+#include "core/inventory_snapshot.h"
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+
+using namespace godot;
+
+class Inventory;
+class CraftStation;
+
+class InventorySaver : public RefCounted {
+	GDCLASS(InventorySaver, RefCounted);
+
+private:
+	Ref<InventoryDatabase> database;
+	PackedStringArray keys;
+	TypedArray<InventorySnapshot> snapshots;
+	bool _saving = false;
+	int64_t _save_task_id = -1;
+	void _add_snapshot(const String &key, const Ref<InventorySnapshot> &snapshot, const Ref<InventoryDatabase> &snapshot_database);
+	void _finish_save(const String &path, const int error);
+	static void _save_task(const Ref<InventorySaver> &saver, const PackedStringArray &snapshot_keys, const TypedArray<InventorySnapshot> &snapshot_list, const String &path, const int compression_mode);
+
+protected:
+	static void _bind_methods();
+
+public:
+	InventorySaver();
+	~InventorySaver();
+	void add_inventory(const String &key, Inventory *inventory);
+	void add_craft_station(const String &key, CraftStation *craft_station);
+	void clear();
+	bool is_saving() const;
+	Error save_async(const String &path, const int compression_mode = FileAccess::COMPRESSION_ZSTD);
+	static Dictionary load_data(const String &path, const Ref<InventoryDatabase> &load_database);
+};
+
+#endif // INVENTORY_SAVER_CLASS_H
@@ -0,0 +1,137 @@
+#include "inventory_snapshot.h"
+
+void InventorySnapshot::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("is_grid"), &InventorySnapshot::is_grid);
+	ClassDB::bind_method(D_METHOD("get_stack_count"), &InventorySnapshot::get_stack_count);
+	ClassDB::bind_method(D_METHOD("to_dictionary"), &InventorySnapshot::to_dictionary);
+}
+
+InventorySnapshot::InventorySnapshot() {
+}
+
+InventorySnapshot::~InventorySnapshot() {
+}
+
+void InventorySnapshot::capture_stacks(const TypedArray<ItemStack> &stacks, const Ref<InventoryDatabase> &new_database) {
+	// Database-dependent encoding happens here, on the calling thread, so
+	// to_dictionary() can run on a worker without touching the database.
+	compact_properties = new_database != nullptr && new_database->get_compact_stack_properties();
+	data = Dictionary();
+	has_data = false;
+	has_grid = false;
+	int64_t stack_count = stacks.size();
+	item_ids.resize(stack_count);
+	amounts.resize(stack_count);
+	properties.resize(stack_count);
+	encoded_properties.resize(compact_properties ? stack_count : 0);
+	String *item_ids_ptr = item_ids.ptrw();
+	int32_t *amounts_ptr = amounts.ptrw();
+	for (int64_t i = 0; i < stack_count; i++) {
+		Ref<ItemStack> stack = stacks[i];
+		item_ids_ptr[i] = stack->get_item_id();
+		amounts_ptr[i] = stack->get_amount();
+		// Properties can be edited in place later, so only they are copied,
+		// including any nested arrays and dictionaries.
+		Dictionary stack_properties = stack->get_properties();
+		properties[i] = stack_properties.is_empty() ? Dictionary() : stack_properties.duplicate(true);
+		if (compact_properties && !stack_properties.is_empty())
+			encoded_properties[i] = new_database->serialize_stack_properties(item_ids_ptr[i], stack_properties);
+	}
+}
+
+void InventorySnapshot::begin_grid() {
+	has_grid = true;
+	int64_t stack_count = item_ids.size();
+	positions.resize(stack_count * 2);
+	positions.fill(0);
+	rotations.resize(stack_count);
+	rotations.fill(0);
+}
+
+void InventorySnapshot::set_grid_stack(const int stack_index, const Vector2i &position, const bool is_rotated) {
+	ERR_FAIL_INDEX(stack_index, rotations.size());
+	positions.set(stack_index * 2, position.x);
+	positions.set(stack_index * 2 + 1, position.y);
+	rotations.set(stack_index, is_rotated);
+}
+
+void InventorySnapshot::set_data(const Dictionary &new_data) {
+	data = new_data;
+	has_data = true;
+	item_ids.clear();
+	amounts.clear();
+	properties.clear();
+	encoded_properties.clear();
+	compact_properties = false;
+	positions.clear();
+	rotations.clear();
+	has_grid = false;
+}
+
+bool InventorySnapshot::is_grid() const {
+	return has_grid;
+}
+
+int InventorySnapshot::get_stack_count() const {
+	return item_ids.size();
+}
+
+String InventorySnapshot::get_item_id(const int stack_index) const {
+	ERR_FAIL_INDEX_V(stack_index, item_ids.size(), String());
+	return item_ids[stack_index];
+}
+
+int InventorySnapshot::get_amount(const int stack_index) const {
+	ERR_FAIL_INDEX_V(stack_index, amounts.size(), 0);
+	return amounts[stack_index];
+}
+
+Dictionary InventorySnapshot::get_properties(const int stack_index) const {
+	ERR_FAIL_INDEX_V(stack_index, properties.size(), Dictionary());
+	return properties[stack_index];
+}
+
+Vector2i InventorySnapshot::get_position(const int stack_index) const {
+	ERR_FAIL_INDEX_V(stack_index * 2 + 1, positions.size(), Vector2i(0, 0));
+	return Vector2i(positions[stack_index * 2], positions[stack_index * 2 + 1]);
+}
+
+bool InventorySnapshot::is_rotated(const int stack_index) const {
+	ERR_FAIL_INDEX_V(stack_index, rotations.size(), false);
+	return rotations[stack_index] != 0;
+}
+
+Dictionary InventorySnapshot::to_dictionary() const {
+	if (has_data)
+		return data;
+
+	// Same layout as Inventory::serialize() and GridInventory::serialize().
+	Dictionary result = Dictionary();
+	Array items_data = Array();
+	for (int64_t i = 0; i < item_ids.size(); i++) {
+		Array stack_data = Array();
+		stack_data.append(item_ids[i]);
+		stack_data.append(amounts[i]);
+		Dictionary stack_properties = properties[i];
+		if (!stack_properties.is_empty()) {
+			if (compact_properties) {
+				stack_data.append(encoded_properties[i]);
+			} else {
+				stack_data.append(stack_properties);
+			}
+		}
+		items_data.append(stack_data);
+	}
+	result["items"] = items_data;
+	if (has_grid) {
+		Array positions_data = Array();
+		Array rotations_data = Array();
+		for (int64_t i = 0; i < item_ids.size(); i++) {
+			positions_data.append(get_position(i));
+			rotations_data.append(is_rotated(i));
+		}
+		result["stack_positions"] = positions_data;
+		result["stack_rotations"] = rotations_data;
+	}
+	return result;
+}
@@ -0,0 +1,45 @@
+#ifndef INVENTORY_SNAPSHOT_CLASS_H
+#define INVENTORY_SNAPSHOT_CLASS_H
+
+#include "base/inventory_database.h"
+#include "base/item_stack.h"
+#include <godot_cpp/classes/ref_counted.hpp>
+
+using namespace godot;
+
+class InventorySnapshot : public RefCounted {
+	GDCLASS(InventorySnapshot, RefCounted);
+
+private:
+	PackedStringArray item_ids;
+	PackedInt32Array amounts;
+	Array properties;
+	Array encoded_properties;
+	bool compact_properties = false;
+	bool has_grid = false;
+	PackedInt32Array positions;
+	PackedByteArray rotations;
+	Dictionary data;
+	bool has_data = false;
+
+protected:
+	static void _bind_methods();
+
+public:
+	InventorySnapshot();
+	~InventorySnapshot();
+	void capture_stacks(const TypedArray<ItemStack> &stacks, const Ref<InventoryDatabase> &new_database);
+	void begin_grid();
+	void set_grid_stack(const int stack_index, const Vector2i &position, const bool is_rotated);
+	void set_data(const Dictionary &new_data);
+	bool is_grid() const;
+	int get_stack_count() const;
+	String get_item_id(const int stack_index) const;
+	int get_amount(const int stack_index) const;
+	Dictionary get_properties(const int stack_index) const;
+	Vector2i get_position(const int stack_index) const;
+	bool is_rotated(const int stack_index) const;
+	Dictionary to_dictionary() const;
+};
+
+#endif // INVENTORY_SNAPSHOT_CLASS_H
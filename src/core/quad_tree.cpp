@@ -47,6 +47,7 @@ void QuadTree::QuadNode::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_all_under_rect", "test_rect", "exception_metadata"), &QuadTree::QuadNode::get_all_under_rect, DEFVAL(nullptr));
 	ClassDB::bind_method(D_METHOD("get_all_containing_point", "point", "exception_metadata"), &QuadTree::QuadNode::get_all_containing_point, DEFVAL(nullptr));
 	ClassDB::bind_method(D_METHOD("add", "quad_rect"), &QuadTree::QuadNode::add);
+	ClassDB::bind_method(D_METHOD("build", "quad_rects"), &QuadTree::QuadNode::build);
 	ClassDB::bind_method(D_METHOD("remove", "metadata"), &QuadTree::QuadNode::remove);
 	ClassDB::bind_method(D_METHOD("_collapse"), &QuadTree::QuadNode::_collapse);
 
@@ -141,7 +142,7 @@ bool QuadTree::QuadNode::is_empty() const {
 Ref<QuadTree::QuadRect> QuadTree::QuadNode::get_first_under_rect(const Rect2i &test_rect, const Variant &exception_metadata) const {
 	for (size_t i = 0; i < quad_rects.size(); i++) {
 		Ref<QuadRect> quad_rect = quad_rects[i];
-		if (UtilityFunctions::type_of(exception_metadata) != GDEXTENSION_VARIANT_TYPE_NIL && quad_rect->get_metadata() == exception_metadata)
+		if (exception_metadata.get_type() != Variant::NIL && quad_rect->get_metadata() == exception_metadata)
 			continue;
 		if (quad_rect->get_rect().intersects(test_rect))
 			return quad_rect;
@@ -162,7 +163,7 @@ Ref<QuadTree::QuadRect> QuadTree::QuadNode::get_first_under_rect(const Rect2i &t
 Ref<QuadTree::QuadRect> QuadTree::QuadNode::get_first_containing_point(const Vector2i &point, const Variant &exception_metadata) const {
 	for (size_t quad_rect_index = 0; quad_rect_index < quad_rects.size(); quad_rect_index++) {
 		Ref<QuadRect> quad_rect = quad_rects[quad_rect_index];
-		if (UtilityFunctions::type_of(exception_metadata) != GDEXTENSION_VARIANT_TYPE_NIL && quad_rect->get_metadata() == exception_metadata)
+		if (exception_metadata.get_type() != Variant::NIL && quad_rect->get_metadata() == exception_metadata)
 			continue;
 		if (quad_rect->get_rect().has_point(point))
 			return quad_rect;
@@ -184,9 +185,21 @@ Ref<QuadTree::QuadRect> QuadTree::QuadNode::get_first_containing_point(const Vec
 
 Array QuadTree::QuadNode::get_all_under_rect(const Rect2i &test_rect, const Variant &exception_metadata) const {
 	Array result = Array();
+	_append_all_under_rect(test_rect, exception_metadata, result);
+	return result;
+}
+
+Array QuadTree::QuadNode::get_all_containing_point(const Vector2i &point, const Variant &exception_metadata) const {
+	Array result = Array();
+	_append_all_containing_point(point, exception_metadata, result);
+	return result;
+}
+
+void QuadTree::QuadNode::_append_all_under_rect(const Rect2i &test_rect, const Variant &exception_metadata, Array &result) const {
+	bool has_exception = exception_metadata.get_type() != Variant::NIL;
 	for (size_t quad_rect_index = 0; quad_rect_index < quad_rects.size(); quad_rect_index++) {
 		Ref<QuadRect> quad_rect = quad_rects[quad_rect_index];
-		if (UtilityFunctions::type_of(exception_metadata) != GDEXTENSION_VARIANT_TYPE_NIL && quad_rect->get_metadata() == exception_metadata)
+		if (has_exception && quad_rect->get_metadata() == exception_metadata)
 			continue;
 		if (quad_rect->get_rect().intersects(test_rect))
 			result.append(quad_rect);
@@ -197,16 +210,15 @@ Array QuadTree::QuadNode::get_all_under_rect(const Rect2i &test_rect, const Vari
 			continue;
 		if (!quadrant->rect.intersects(test_rect))
 			continue;
-		result.append_array(quadrant->get_all_under_rect(test_rect, exception_metadata));
+		quadrant->_append_all_under_rect(test_rect, exception_metadata, result);
 	}
-	return result;
 }
 
-Array QuadTree::QuadNode::get_all_containing_point(const Vector2i &point, const Variant &exception_metadata) const {
-	Array result = Array();
+void QuadTree::QuadNode::_append_all_containing_point(const Vector2i &point, const Variant &exception_metadata, Array &result) const {
+	bool has_exception = exception_metadata.get_type() != Variant::NIL;
 	for (size_t quad_rect_index = 0; quad_rect_index < quad_rects.size(); quad_rect_index++) {
 		Ref<QuadRect> quad_rect = quad_rects[quad_rect_index];
-		if (UtilityFunctions::type_of(exception_metadata) != GDEXTENSION_VARIANT_TYPE_NIL && quad_rect->get_metadata() == exception_metadata)
+		if (has_exception && quad_rect->get_metadata() == exception_metadata)
 			continue;
 		if (quad_rect->get_rect().has_point(point))
 			result.append(quad_rect);
@@ -217,9 +229,8 @@ Array QuadTree::QuadNode::get_all_containing_point(const Vector2i &point, const
 			continue;
 		if (!quadrant->rect.has_point(point))
 			continue;
-		result.append_array(quadrant->get_all_containing_point(point, exception_metadata));
+		quadrant->_append_all_containing_point(point, exception_metadata, result);
 	}
-	return result;
 }
 
 void QuadTree::QuadNode::add(const Ref<QuadTree::QuadRect> &quad_rect) {
@@ -253,6 +264,39 @@ void QuadTree::QuadNode::add(const Ref<QuadTree::QuadRect> &quad_rect) {
 	}
 }
 
+void QuadTree::QuadNode::build(const TypedArray<QuadTree::QuadRect> &new_quad_rects) {
+	for (size_t i = 0; i < quadrants.size(); i++) {
+		quadrants[i] = nullptr;
+	}
+	quadrant_count = 0;
+	quad_rects = TypedArray<QuadRect>();
+
+	// Same layout that successive add() calls settle into: a node keeps its rects
+	// when it holds a single one or cannot be split further.
+	if (new_quad_rects.size() <= 1 || !can_subdivide(rect.size)) {
+		quad_rects.append_array(new_quad_rects);
+		return;
+	}
+
+	TypedArray<Rect2i> quadrant_rects = get_quadrant_rects(rect);
+	for (size_t i = 0; i < quadrant_rects.size(); i++) {
+		Rect2i quadrant_rect = quadrant_rects[i];
+		TypedArray<QuadRect> quadrant_quad_rects = TypedArray<QuadRect>();
+		for (size_t quad_rect_index = 0; quad_rect_index < new_quad_rects.size(); quad_rect_index++) {
+			Ref<QuadRect> quad_rect = new_quad_rects[quad_rect_index];
+			if (quadrant_rect.intersects(quad_rect->get_rect()))
+				quadrant_quad_rects.append(quad_rect);
+		}
+		if (quadrant_quad_rects.is_empty())
+			continue;
+		Ref<QuadNode> quadrant = memnew(QuadNode());
+		quadrant->set_rect(quadrant_rect);
+		quadrants[i] = quadrant;
+		quadrant_count += 1;
+		quadrant->build(quadrant_quad_rects);
+	}
+}
+
 bool QuadTree::QuadNode::remove(const Variant &metadata) {
 	bool result = false;
 	for (int i = (quad_rects.size() - 1); i >= 0; i--) {
@@ -310,8 +354,17 @@ void QuadTree::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_first", "at", "exception_metadata"), &QuadTree::get_first, DEFVAL(nullptr));
     ClassDB::bind_method(D_METHOD("get_all", "at", "exception_metadata"), &QuadTree::get_all, DEFVAL(nullptr));
     ClassDB::bind_method(D_METHOD("add", "rect", "metadata"), &QuadTree::add);
+    ClassDB::bind_method(D_METHOD("build", "rects", "metadatas"), &QuadTree::build);
     ClassDB::bind_method(D_METHOD("remove", "metadata"), &QuadTree::remove);
+    ClassDB::bind_method(D_METHOD("move", "metadata", "new_rect"), &QuadTree::move);
     ClassDB::bind_method(D_METHOD("is_empty"), &QuadTree::is_empty);
+	ClassDB::bind_method(D_METHOD("get_id", "metadata"), &QuadTree::get_id);
+	ClassDB::bind_method(D_METHOD("get_metadata_by_id", "id"), &QuadTree::get_metadata_by_id);
+	ClassDB::bind_method(D_METHOD("query_first_rect", "rect", "exception_id"), &QuadTree::query_first_rect, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("query_first_point", "point", "exception_id"), &QuadTree::query_first_point, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("query_rect", "rect", "exception_id"), &QuadTree::query_rect_ids, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("query_point", "point", "exception_id"), &QuadTree::query_point_ids, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("query_rects", "rects", "exception_id"), &QuadTree::query_rects, DEFVAL(-1));
 
 	ClassDB::bind_method(D_METHOD("set_root", "root"), &QuadTree::set_root);
 	ClassDB::bind_method(D_METHOD("get_root"), &QuadTree::get_root);
@@ -330,55 +383,231 @@ QuadTree::QuadTree() {
 QuadTree::~QuadTree() {
 }
 
+int32_t QuadTree::_find_payload(const Variant &metadata) const {
+	const int32_t *payload = payload_ids.getptr(metadata);
+	return payload == nullptr ? FlatQuadTree::INVALID : *payload;
+}
+
+int32_t QuadTree::_get_or_create_payload(const Variant &metadata) {
+	int32_t payload = _find_payload(metadata);
+	if (payload != FlatQuadTree::INVALID)
+		return payload;
+	if (!free_payloads.is_empty()) {
+		payload = free_payloads[free_payloads.size() - 1];
+		free_payloads.resize(free_payloads.size() - 1);
+		payload_metadatas[payload] = metadata;
+	} else {
+		payload = payload_metadatas.size();
+		payload_metadatas.push_back(metadata);
+	}
+	payload_ids.insert(metadata, payload);
+	return payload;
+}
+
+void QuadTree::_release_payload(const int32_t payload) {
+	payload_ids.erase(payload_metadatas[payload]);
+	payload_metadatas[payload] = Variant();
+	free_payloads.push_back(payload);
+}
+
+Ref<QuadTree::QuadRect> QuadTree::_make_quad_rect(const int32_t item_id) const {
+	if (item_id == FlatQuadTree::INVALID)
+		return nullptr;
+	Ref<QuadTree::QuadRect> quad_rect = memnew(QuadTree::QuadRect());
+	quad_rect->_init(tree.get_item_rect(item_id), payload_metadatas[tree.get_item_payload(item_id)]);
+	return quad_rect;
+}
+
+Ref<QuadTree::QuadNode> QuadTree::_make_quad_node(const int32_t node_id) const {
+	Ref<QuadTree::QuadNode> quad_node = memnew(QuadTree::QuadNode());
+	quad_node->_init(tree.get_node_rect(node_id));
+	LocalVector<int32_t> item_ids;
+	tree.get_node_items(node_id, item_ids);
+	TypedArray<QuadTree::QuadRect> quad_rects = TypedArray<QuadTree::QuadRect>();
+	for (uint32_t i = 0; i < item_ids.size(); i++) {
+		quad_rects.append(_make_quad_rect(item_ids[i]));
+	}
+	quad_node->set_quad_rects(quad_rects);
+	TypedArray<QuadTree::QuadNode> quadrants = quad_node->get_quadrants();
+	for (int i = 0; i < 4; i++) {
+		int32_t quadrant = tree.get_node_quadrant(node_id, i);
+		if (quadrant != FlatQuadTree::INVALID)
+			quadrants[i] = _make_quad_node(quadrant);
+	}
+	quad_node->set_quadrants(quadrants);
+	quad_node->set_quadrant_count(tree.get_node_quadrant_count(node_id));
+	return quad_node;
+}
+
 void QuadTree::init(const Vector2i &size) {
 	this->size = size;
-	Ref<QuadTree::QuadNode> new_node = memnew(QuadTree::QuadNode());
-    ERR_FAIL_NULL_MSG(new_node, "'new_node' is null.");
-	new_node->_init(Rect2i(Vector2i(0, 0), this->size));
-	set_root(new_node);
+	tree.init(size);
+	payload_metadatas.clear();
+	free_payloads.clear();
+	payload_ids.clear();
 }
 
 Ref<QuadTree::QuadRect> QuadTree::get_first(const Variant &at, const Variant &exception_metadata) const {
-	ERR_FAIL_NULL_V_MSG(this->root, nullptr, "'root' is null.");
-	if (UtilityFunctions::type_of(at) == GDEXTENSION_VARIANT_TYPE_RECT2I)
-		return this->root->get_first_under_rect(at, exception_metadata);
-	if (UtilityFunctions::type_of(at) == GDEXTENSION_VARIANT_TYPE_VECTOR2I)
-		return this->root->get_first_containing_point(at, exception_metadata);
+	int32_t exception_payload = exception_metadata.get_type() == Variant::NIL ? FlatQuadTree::INVALID : _find_payload(exception_metadata);
+	if (at.get_type() == Variant::RECT2I)
+		return _make_quad_rect(tree.get_first(Rect2i(at), exception_payload));
+	if (at.get_type() == Variant::VECTOR2I)
+		return _make_quad_rect(tree.get_first_at(Vector2i(at), exception_payload));
 	return nullptr;
 }
 
 Array QuadTree::get_all(const Variant &at, const Variant &exception_metadata) const {
-	ERR_FAIL_NULL_V_MSG(this->root, TypedArray<QuadTree::QuadRect>(), "'root' is null.");
-	if (UtilityFunctions::type_of(at) == GDEXTENSION_VARIANT_TYPE_RECT2I)
-		return this->root->get_all_under_rect(at, exception_metadata);
-	if (UtilityFunctions::type_of(at) == GDEXTENSION_VARIANT_TYPE_VECTOR2I)
-		return this->root->get_all_containing_point(at, exception_metadata);
-	return TypedArray<QuadTree::QuadRect>();
+	int32_t exception_payload = exception_metadata.get_type() == Variant::NIL ? FlatQuadTree::INVALID : _find_payload(exception_metadata);
+	LocalVector<int32_t> item_ids;
+	if (at.get_type() == Variant::RECT2I)
+		tree.get_all(Rect2i(at), item_ids, exception_payload);
+	else if (at.get_type() == Variant::VECTOR2I)
+		tree.get_all_at(Vector2i(at), item_ids, exception_payload);
+	Array result = Array();
+	for (uint32_t i = 0; i < item_ids.size(); i++) {
+		result.append(_make_quad_rect(item_ids[i]));
+	}
+	return result;
 }
 
 void QuadTree::add(const Rect2i &rect, const Variant &metadata) {
-    ERR_FAIL_NULL_MSG(root, "'root node' is null.");
-	Ref<QuadTree::QuadRect> new_quad_rect = memnew(QuadTree::QuadRect());
-	new_quad_rect->_init(rect, metadata);
-	root->add(new_quad_rect);
+	ERR_FAIL_COND_MSG(tree.get_root() == FlatQuadTree::INVALID, "'root node' is null.");
+	tree.add(rect, _get_or_create_payload(metadata));
+}
+
+void QuadTree::build(const TypedArray<Rect2i> &rects, const Array &metadatas) {
+	ERR_FAIL_COND_MSG(rects.size() != metadatas.size(), "'rects' and 'metadatas' must have the same size.");
+	init(size);
+	LocalVector<Rect2i> new_rects;
+	LocalVector<int32_t> payloads;
+	new_rects.resize(rects.size());
+	payloads.resize(rects.size());
+	for (int64_t i = 0; i < rects.size(); i++) {
+		new_rects[i] = rects[i];
+		payloads[i] = _get_or_create_payload(metadatas[i]);
+	}
+	tree.build(new_rects, payloads);
 }
 
 bool QuadTree::remove(const Variant &metadata) {
-    ERR_FAIL_NULL_V_MSG(root, false, "'root node' is null.");
-	return root->remove(metadata);
+	ERR_FAIL_COND_V_MSG(tree.get_root() == FlatQuadTree::INVALID, false, "'root node' is null.");
+	int32_t payload = _find_payload(metadata);
+	if (payload == FlatQuadTree::INVALID)
+		return false;
+	bool result = tree.remove(payload);
+	_release_payload(payload);
+	return result;
+}
+
+bool QuadTree::move(const Variant &metadata, const Rect2i &new_rect) {
+	ERR_FAIL_COND_V_MSG(tree.get_root() == FlatQuadTree::INVALID, false, "'root node' is null.");
+	int32_t payload = _find_payload(metadata);
+	if (payload == FlatQuadTree::INVALID)
+		return false;
+	return tree.move(payload, new_rect);
 }
 
 bool QuadTree::is_empty() const {
-    ERR_FAIL_NULL_V_MSG(root, true, "'root node' is null.");
-	return root->is_empty();
+	ERR_FAIL_COND_V_MSG(tree.get_root() == FlatQuadTree::INVALID, true, "'root node' is null.");
+	return tree.is_empty();
+}
+
+const FlatQuadTree &QuadTree::get_flat_tree() const {
+	return tree;
+}
+
+int QuadTree::get_id(const Variant &metadata) const {
+	return _find_payload(metadata);
+}
+
+Variant QuadTree::get_metadata_by_id(const int id) const {
+	ERR_FAIL_INDEX_V(id, int(payload_metadatas.size()), Variant());
+	return payload_metadatas[id];
+}
+
+int QuadTree::query_first_rect(const Rect2i &rect, const int exception_id) const {
+	int32_t item_id = tree.get_first(rect, exception_id);
+	return item_id == FlatQuadTree::INVALID ? -1 : tree.get_item_payload(item_id);
+}
+
+int QuadTree::query_first_point(const Vector2i &point, const int exception_id) const {
+	int32_t item_id = tree.get_first_at(point, exception_id);
+	return item_id == FlatQuadTree::INVALID ? -1 : tree.get_item_payload(item_id);
+}
+
+void QuadTree::query_rect(const Rect2i &rect, LocalVector<int32_t> &result, const int exception_id) const {
+	uint32_t start = result.size();
+	tree.get_all(rect, result, exception_id);
+	for (uint32_t i = start; i < result.size(); i++) {
+		result[i] = tree.get_item_payload(result[i]);
+	}
+}
+
+void QuadTree::query_point(const Vector2i &point, LocalVector<int32_t> &result, const int exception_id) const {
+	uint32_t start = result.size();
+	tree.get_all_at(point, result, exception_id);
+	for (uint32_t i = start; i < result.size(); i++) {
+		result[i] = tree.get_item_payload(result[i]);
+	}
+}
+
+PackedInt32Array QuadTree::query_rect_ids(const Rect2i &rect, const int exception_id) const {
+	LocalVector<int32_t> ids;
+	query_rect(rect, ids, exception_id);
+	PackedInt32Array result;
+	result.resize(ids.size());
+	int32_t *result_ptr = result.ptrw();
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		result_ptr[i] = ids[i];
+	}
+	return result;
+}
+
+PackedInt32Array QuadTree::query_point_ids(const Vector2i &point, const int exception_id) const {
+	LocalVector<int32_t> ids;
+	query_point(point, ids, exception_id);
+	PackedInt32Array result;
+	result.resize(ids.size());
+	int32_t *result_ptr = result.ptrw();
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		result_ptr[i] = ids[i];
+	}
+	return result;
+}
+
+PackedInt32Array QuadTree::query_rects(const TypedArray<Rect2i> &rects, const int exception_id) const {
+	// One entry per rect: the id of the first rect found under it, or -1.
+	PackedInt32Array result;
+	result.resize(rects.size());
+	int32_t *result_ptr = result.ptrw();
+	for (int64_t i = 0; i < rects.size(); i++) {
+		result_ptr[i] = query_first_rect(rects[i], exception_id);
+	}
+	return result;
 }
 
 void QuadTree::set_root(const Ref<QuadNode> &new_root) {
-	root = new_root;
+	// A script-built node tree is copied in by re-adding its rects.
+	if (new_root == nullptr) {
+		init(size);
+		return;
+	}
+	init(new_root->get_rect().size);
+	Array quad_rects = new_root->get_all_under_rect(new_root->get_rect());
+	Array added = Array();
+	for (int64_t i = 0; i < quad_rects.size(); i++) {
+		Ref<QuadRect> quad_rect = quad_rects[i];
+		if (quad_rect == nullptr || added.has(quad_rect))
+			continue;
+		added.append(quad_rect);
+		add(quad_rect->get_rect(), quad_rect->get_metadata());
+	}
 }
 
 Ref<QuadTree::QuadNode> QuadTree::get_root() const {
-	return root;
+	if (tree.get_root() == FlatQuadTree::INVALID)
+		return nullptr;
+	return _make_quad_node(tree.get_root());
 }
 
 void QuadTree::set_size(const Vector2i &new_size) {
@@ -387,4 +616,4 @@ void QuadTree::set_size(const Vector2i &new_size) {
 
 Vector2i QuadTree::get_size() const {
 	return size;
-}
\ No newline at end of file
+}
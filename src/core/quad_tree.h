@@ -1,7 +1,9 @@
 #ifndef QUAD_TREE_CLASS_H
 #define QUAD_TREE_CLASS_H
 
+#include "core/flat_quad_tree.h"
 #include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
 
 using namespace godot;
 
@@ -34,6 +36,8 @@ public:
 		int quadrant_count = 0;
 		TypedArray<QuadRect> quad_rects;
 		Rect2i rect;
+		void _append_all_under_rect(const Rect2i &test_rect, const Variant &exception_metadata, Array &result) const;
+		void _append_all_containing_point(const Vector2i &point, const Variant &exception_metadata, Array &result) const;
         
 	protected:
 		static void _bind_methods();
@@ -59,13 +63,25 @@ public:
 		Array get_all_under_rect(const Rect2i &test_rect, const Variant &exception_metadata = nullptr) const;
 		Array get_all_containing_point(const Vector2i &point, const Variant &exception_metadata = nullptr) const;
 		void add(const Ref<QuadRect> &quad_rect);
+		void build(const TypedArray<QuadRect> &new_quad_rects);
 		bool remove(const Variant &metadata);
 		void _collapse();
 	};
 
 private:
-	Ref<QuadNode> root;
+	FlatQuadTree tree;
 	Vector2i size;
+	// Metadata is mapped to an integer payload once, so the tree itself never
+	// compares Variants. QuadRect and QuadNode objects are only created when
+	// scripts ask for them.
+	LocalVector<Variant> payload_metadatas;
+	LocalVector<int32_t> free_payloads;
+	HashMap<Variant, int32_t, VariantHasher, VariantComparator> payload_ids;
+	int32_t _find_payload(const Variant &metadata) const;
+	int32_t _get_or_create_payload(const Variant &metadata);
+	void _release_payload(const int32_t payload);
+	Ref<QuadRect> _make_quad_rect(const int32_t item_id) const;
+	Ref<QuadNode> _make_quad_node(const int32_t node_id) const;
 
 protected:
 	static void _bind_methods();
@@ -77,8 +93,23 @@ public:
 	Ref<QuadTree::QuadRect> get_first(const Variant &at, const Variant &exception_metadata = nullptr) const;
 	Array get_all(const Variant &at, const Variant &exception_metadata = nullptr) const;
 	void add(const Rect2i &rect, const Variant &metadata);
+	void build(const TypedArray<Rect2i> &rects, const Array &metadatas);
 	bool remove(const Variant &metadata);
+	bool move(const Variant &metadata, const Rect2i &new_rect);
 	bool is_empty() const;
+	const FlatQuadTree &get_flat_tree() const;
+
+	// Typed queries by integer id, see get_id(). The C++ overloads append to a
+	// caller-owned buffer so loops can reuse it.
+	int get_id(const Variant &metadata) const;
+	Variant get_metadata_by_id(const int id) const;
+	int query_first_rect(const Rect2i &rect, const int exception_id = -1) const;
+	int query_first_point(const Vector2i &point, const int exception_id = -1) const;
+	void query_rect(const Rect2i &rect, LocalVector<int32_t> &result, const int exception_id = -1) const;
+	void query_point(const Vector2i &point, LocalVector<int32_t> &result, const int exception_id = -1) const;
+	PackedInt32Array query_rect_ids(const Rect2i &rect, const int exception_id = -1) const;
+	PackedInt32Array query_point_ids(const Vector2i &point, const int exception_id = -1) const;
+	PackedInt32Array query_rects(const TypedArray<Rect2i> &rects, const int exception_id = -1) const;
 
 	void set_root(const Ref<QuadNode> &new_root);
 	Ref<QuadNode> get_root() const;
@@ -70,6 +70,7 @@ void CraftStation::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("finish_crafting", "crafting_index"), &CraftStation::finish_crafting);
 	ClassDB::bind_method(D_METHOD("get_input_inventory", "index"), &CraftStation::get_input_inventory, DEFVAL(0));
 	ClassDB::bind_method(D_METHOD("serialize"), &CraftStation::serialize);
+	ClassDB::bind_method(D_METHOD("capture_snapshot"), &CraftStation::capture_snapshot);
 	ClassDB::bind_method(D_METHOD("deserialize", "data"), &CraftStation::deserialize);
 
 	ClassDB::bind_method(D_METHOD("set_input_inventories", "input_inventories"), &CraftStation::set_input_inventories);
@@ -295,15 +296,9 @@ void CraftStation::load_valid_recipes() {
 	type = get_database()->get_craft_station_from_id(type_id);
 
 	valid_recipes.clear();
-	for (int i = 0; i < get_database()->get_recipes().size(); i++) {
-		Ref<Recipe> recipe = get_database()->get_recipes()[i];
-		String recipe_craft_id = "";
-		if (recipe->get_station() != nullptr) {
-			recipe_craft_id = recipe->get_station()->get_id();
-		}
-		if (recipe_craft_id == type_id) {
-			valid_recipes.append(i);
-		}
+	PackedInt32Array recipe_indexes = get_database()->get_recipes_for_station(type_id);
+	for (int i = 0; i < recipe_indexes.size(); i++) {
+		valid_recipes.append(recipe_indexes[i]);
 	}
 }
 
@@ -612,3 +607,11 @@ void CraftStation::deserialize(const Dictionary data) {
 		craftings.remove_at(craftings_data.size());
 	}
 }
+
+Ref<InventorySnapshot> CraftStation::capture_snapshot() const {
+	// Craftings are few and serialize() already builds new containers.
+	Ref<InventorySnapshot> snapshot;
+	snapshot.instantiate();
+	snapshot->set_data(serialize());
+	return snapshot;
+}
@@ -120,6 +120,7 @@ public:
 	void remove_input_inventory(Inventory *input_inventory);
 	Dictionary serialize() const;
 	void deserialize(const Dictionary data);
+	Ref<InventorySnapshot> capture_snapshot() const;
 };
 
 VARIANT_ENUM_CAST(CraftStation::ProcessingMode);
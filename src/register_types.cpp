@@ -17,6 +17,9 @@
 #include "core/quad_tree.h"
 #include "core/hotbar.h"
 #include "core/inventory.h"
+#include "core/inventory_journal.h"
+#include "core/inventory_saver.h"
+#include "core/inventory_snapshot.h"
 #include "core/grid_inventory.h"
 #include "craft/craft_station.h"
 
@@ -42,6 +45,9 @@ void initialize_gdextension_types(ModuleInitializationLevel p_level) {
 	GDREGISTER_CLASS(Hotbar::Slot);
 	GDREGISTER_CLASS(Inventory);
 	GDREGISTER_CLASS(GridInventory);
+	GDREGISTER_CLASS(InventoryJournal);
+	GDREGISTER_CLASS(InventorySnapshot);
+	GDREGISTER_CLASS(InventorySaver);
 	GDREGISTER_CLASS(CraftStation);
 	GDREGISTER_CLASS(Crafting);
 }
@@ -0,0 +1,57 @@
+extends "inventory_test.gd"
+## Times first-fit placement of a 2x3 item on 16x16 to 128x128 grids filled
+## to 0-90% with 1x1 items at random cells.
+##
+## "probe" replays the old per-origin search from script through rect_free,
+## so it also pays the script call per origin. "add" is the native
+## bit-parallel search behind add(), timed together with creating and
+## removing the stack.
+
+const SIZES := [16, 32, 64, 128]
+const FILLS := [0.0, 0.5, 0.75, 0.9]
+const ITEM_SIZE := Vector2i(2, 3)
+
+
+func _run() -> void:
+	var database := make_database([make_item("pebble", Vector2i(1, 1), 1), make_item("crate", ITEM_SIZE, 1)])
+	var rng := RandomNumberGenerator.new()
+	print("grid      fill   probe_us     add_us")
+	for grid_size in SIZES:
+		for fill in FILLS:
+			rng.seed = grid_size * 100 + int(fill * 100)
+			var inventory := make_grid(database, Vector2i(grid_size, grid_size))
+			_fill_random(inventory, grid_size, fill, rng)
+			var repeats := maxi(2000 / grid_size, 5)
+
+			var start := Time.get_ticks_usec()
+			for i in repeats:
+				_probe_first_fit(inventory, grid_size)
+			var probe_usec := usec_since(start) / float(repeats)
+
+			start = Time.get_ticks_usec()
+			for i in repeats:
+				if inventory.add("crate", 1) == 0:
+					inventory.remove_stack(inventory.stacks.size() - 1)
+			var add_usec := usec_since(start) / float(repeats)
+
+			print("%3dx%-3d  %3d%%  %9.2f  %9.2f" % [grid_size, grid_size, int(fill * 100), probe_usec, add_usec])
+			inventory.free()
+
+
+func _fill_random(inventory: GridInventory, grid_size: int, fill: float, rng: RandomNumberGenerator) -> void:
+	var cells := range(grid_size * grid_size)
+	for i in range(cells.size() - 1, 0, -1):
+		var j := rng.randi_range(0, i)
+		var cell = cells[i]
+		cells[i] = cells[j]
+		cells[j] = cell
+	for i in int(fill * cells.size()):
+		inventory.add_at_position(Vector2i(cells[i] % grid_size, cells[i] / grid_size), "pebble", 1)
+
+
+func _probe_first_fit(inventory: GridInventory, grid_size: int) -> Vector2i:
+	for y in grid_size - ITEM_SIZE.y + 1:
+		for x in grid_size - ITEM_SIZE.x + 1:
+			if inventory.rect_free(Rect2i(Vector2i(x, y), ITEM_SIZE)):
+				return Vector2i(x, y)
+	return Vector2i(-1, -1)
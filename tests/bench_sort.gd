@@ -0,0 +1,69 @@
+extends "inventory_test.gd"
+## Packing density and time of GridInventory.sort on grids filled with a
+## mix of item sizes, then fragmented by removing a random third of the
+## stacks.
+##
+## Density is the occupied share of the rows in use (width times the lowest
+## used row). "extra" is how many more 2x2 items fit after sorting than
+## before it.
+
+const GRIDS := [Vector2i(10, 6), Vector2i(16, 16), Vector2i(32, 32), Vector2i(64, 64), Vector2i(128, 128)]
+const RUNS := 5
+# Consumables 1x1 and 1x2, tools 1x3, armor 2x2, weapons 2x3, bags 3x4.
+const MIX := ["small", "small", "small", "tall", "tall", "tool", "armor", "armor", "weapon", "bag"]
+
+
+func _run() -> void:
+	var database := make_database([
+		make_item("small", Vector2i(1, 1), 1),
+		make_item("tall", Vector2i(1, 2), 1),
+		make_item("tool", Vector2i(1, 3), 1),
+		make_item("armor", Vector2i(2, 2), 1),
+		make_item("weapon", Vector2i(2, 3), 1),
+		make_item("bag", Vector2i(3, 4), 1),
+		make_item("probe", Vector2i(2, 2), 1),
+	])
+	var rng := RandomNumberGenerator.new()
+	print("grid      items  before   after  extra    sort_us")
+	for grid_size in GRIDS:
+		var totals := [0.0, 0.0, 0.0, 0.0, 0.0]
+		for run in RUNS:
+			rng.seed = grid_size.x * 1000 + run
+			var inventory := make_grid(database, grid_size)
+			var failures := 0
+			while failures < 20:
+				if inventory.add(MIX[rng.randi() % MIX.size()], 1) != 0:
+					failures += 1
+			for i in inventory.stacks.size() / 3:
+				inventory.remove_stack(rng.randi() % inventory.stacks.size())
+			totals[0] += inventory.stacks.size()
+			totals[1] += _density(inventory)
+			var before_extra := _count_extra(inventory)
+
+			var start := Time.get_ticks_usec()
+			check(inventory.sort(), "sort failed on %s" % grid_size)
+			totals[4] += usec_since(start)
+			totals[2] += _density(inventory)
+			totals[3] += _count_extra(inventory) - before_extra
+			inventory.free()
+		print("%3dx%-3d  %5d  %5.1f%%  %5.1f%%  %5.1f  %9.1f" % [grid_size.x, grid_size.y, totals[0] / RUNS, 100.0 * totals[1] / RUNS, 100.0 * totals[2] / RUNS, totals[3] / RUNS, totals[4] / RUNS])
+
+
+func _density(inventory: GridInventory) -> float:
+	var cells := 0
+	var bottom := 0
+	for stack in inventory.stacks:
+		var rect := inventory.get_stack_rect(stack)
+		cells += rect.get_area()
+		bottom = maxi(bottom, rect.end.y)
+	return 0.0 if bottom == 0 else float(cells) / (inventory.size.x * bottom)
+
+
+# Adds 2x2 probes until one no longer fits, then takes them out again.
+func _count_extra(inventory: GridInventory) -> int:
+	var count := 0
+	while inventory.add("probe", 1) == 0:
+		count += 1
+	if count > 0:
+		inventory.remove("probe", count)
+	return count
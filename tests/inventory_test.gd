@@ -0,0 +1,58 @@
+extends SceneTree
+## Base for the headless tests and benchmarks in this folder.
+##
+## Run one from a project that loads the extension:
+## [codeblock]
+## godot --headless --path <project> -s <path to>/tests/test_grid_swap.gd
+## [/codeblock]
+## The process exits with code 1 when any check fails.
+
+var failures := 0
+
+
+func _initialize() -> void:
+	_run()
+	var file_name := (get_script() as Script).resource_path.get_file()
+	if failures == 0:
+		print("%s: ok" % file_name)
+	else:
+		printerr("%s: %d check(s) failed" % [file_name, failures])
+	quit(1 if failures > 0 else 0)
+
+
+func _run() -> void:
+	pass
+
+
+func check(condition: bool, message: String) -> void:
+	if not condition:
+		failures += 1
+		printerr("FAILED: " + message)
+
+
+func make_item(id: String, size := Vector2i(1, 1), max_stack := 16) -> ItemDefinition:
+	var item := ItemDefinition.new()
+	item.id = id
+	item.name = id
+	item.size = size
+	item.max_stack = max_stack
+	return item
+
+
+func make_database(items: Array) -> InventoryDatabase:
+	var database := InventoryDatabase.new()
+	for item in items:
+		database.add_new_item(item)
+	return database
+
+
+func make_grid(database: InventoryDatabase, size: Vector2i) -> GridInventory:
+	var inventory := GridInventory.new()
+	inventory.database = database
+	inventory.size = size
+	root.add_child(inventory)
+	return inventory
+
+
+func usec_since(start: int) -> int:
+	return Time.get_ticks_usec() - start
@@ -0,0 +1,29 @@
+extends "inventory_test.gd"
+## The byte reader parses save files and network op streams, so malformed
+## lengths must fail cleanly.
+
+
+func _run() -> void:
+	var sword := make_item("sword")
+	sword.properties = {"owner": ""}
+	sword.dynamic_properties = ["owner"]
+	var database := make_database([sword])
+
+	# Layout: u32 schema hash, section length, then the section (three mask
+	# varints, string length, "ana"), then the extras count.
+	var data := database.serialize_stack_properties("sword", {"owner": "ana"})
+	check(data.size() == 13 and data[4] == 7 and data[8] == 3, "unexpected layout of the encoded properties")
+
+	# Swap the string length for a ten-byte varint that decodes to a negative
+	# int64 and fix up the section length around it.
+	var section := data.slice(5, 8)
+	for i in 9:
+		section.append(0xFF)
+	section.append(0x01)
+	section.append_array(data.slice(9, 12))
+	var patched := data.slice(0, 4)
+	patched.append(section.size())
+	patched.append_array(section)
+	patched.append(0)
+	var decoded := database.deserialize_stack_properties("sword", patched)
+	check(decoded.is_empty(), "a negative string length was accepted: %s" % decoded)
@@ -0,0 +1,53 @@
+extends "inventory_test.gd"
+## Inventory.defragment must emit stack_removed for every stack it merges
+## away, with indices that are valid when each signal fires.
+
+
+func make_stack(item_id: String, amount: int) -> ItemStack:
+	var stack := ItemStack.new()
+	stack.item_id = item_id
+	stack.amount = amount
+	return stack
+
+
+func _run() -> void:
+	var database := make_database([make_item("sword", Vector2i(1, 1), 10), make_item("gem")])
+
+	var inventory := Inventory.new()
+	inventory.database = database
+	root.add_child(inventory)
+	inventory.stacks = [
+		make_stack("sword", 4),
+		make_stack("gem", 2),
+		make_stack("sword", 4),
+		make_stack("sword", 4),
+		make_stack("gem", 3),
+	]
+	var removed_indices := []
+	inventory.stack_removed.connect(func(index: int):
+		check(index >= 0 and index <= inventory.stacks.size(), "stack_removed index %d is out of range" % index)
+		removed_indices.append(index))
+	check(inventory.defragment() == 2, "defragment did not report two removed stacks")
+	# Swords 4 + 4 + 2 fill the first stack, the third keeps 2; gems merge into one.
+	check(removed_indices == [4, 2], "stack_removed was not emitted per removed stack: %s" % [removed_indices])
+	check(inventory.stacks.size() == 3, "defragment left %d stacks" % inventory.stacks.size())
+	check(inventory.stacks[0].amount == 10, "the first sword stack was not filled")
+	check(inventory.stacks[1].item_id == "gem" and inventory.stacks[1].amount == 5, "the gems were not merged")
+	check(inventory.stacks[2].amount == 2, "the sword remainder is wrong")
+	check(inventory.amount() == 17, "defragment changed the total amount")
+
+	# Nothing to merge, nothing to signal.
+	removed_indices.clear()
+	check(inventory.defragment() == 0, "a second defragment removed stacks")
+	check(removed_indices.is_empty(), "a second defragment emitted stack_removed")
+
+	# A GridInventory announces the merged stacks the same way before packing.
+	var grid := make_grid(database, Vector2i(3, 1))
+	grid.add_at_position(Vector2i(0, 0), "sword", 3)
+	grid.add_at_position(Vector2i(2, 0), "sword", 3)
+	var grid_removed := []
+	grid.stack_removed.connect(func(index: int): grid_removed.append(index))
+	check(grid.stacks.size() == 2, "the grid setup did not create two stacks")
+	check(grid.defragment() == 1, "grid defragment did not report one removed stack")
+	check(grid_removed == [1], "grid defragment did not emit stack_removed: %s" % [grid_removed])
+	check(grid.stacks.size() == 1 and grid.stacks[0].amount == 6, "grid defragment did not merge the swords")
@@ -0,0 +1,36 @@
+extends "inventory_test.gd"
+## A grid constraint with a cell mask is enforced through the occupancy
+## bitmap alone unless it opts into script checks.
+
+
+class CountingConstraint extends GridInventoryConstraint:
+	var calls := 0
+
+	func _can_add_on_position(_inventory: Node, _position: Vector2i, _item_id: String, _amount: int, _properties: Dictionary, _is_rotated: bool) -> bool:
+		calls += 1
+		return true
+
+
+func _run() -> void:
+	var database := make_database([make_item("gem"), make_item("rock")])
+	var inventory := make_grid(database, Vector2i(4, 4))
+	# Gems only go in the bottom row.
+	var constraint := CountingConstraint.new()
+	var cells := PackedByteArray()
+	cells.resize(16)
+	for x in 4:
+		cells[12 + x] = 1
+	constraint.allowed_cells_size = Vector2i(4, 4)
+	constraint.allowed_cells = cells
+	constraint.item_ids = PackedStringArray(["gem"])
+	inventory.grid_constraints = [constraint]
+
+	inventory.add("gem", 1)
+	inventory.add("rock", 1)
+	check(inventory.get_stack_at(Vector2i(0, 3)).item_id == "gem", "the mask did not place the gem in the bottom row")
+	check(inventory.get_stack_at(Vector2i(0, 0)).item_id == "rock", "the mask restricted an item it does not filter")
+	check(constraint.calls == 0, "a masked constraint called its script %d times" % constraint.calls)
+
+	constraint.call_script_check = true
+	inventory.add("gem", 1)
+	check(constraint.calls > 0, "call_script_check did not run the script")
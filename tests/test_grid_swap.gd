@@ -0,0 +1,49 @@
+extends "inventory_test.gd"
+## GridInventory.swap_stacks between two inventories must keep the
+## InventoryConstraint admission checks of the remove + add it replaces.
+
+
+class RejectItem extends InventoryConstraint:
+	var rejected_id := ""
+
+	func _can_add_on_inventory(_inventory: Node, item_id: String, _amount: int, _properties: Dictionary) -> bool:
+		return item_id != rejected_id
+
+
+class OneStack extends InventoryConstraint:
+	func _can_add_new_stack_on_inventory(inventory: Node, _item_id: String, _amount: int, _properties: Dictionary) -> bool:
+		return inventory.stacks.size() < 1
+
+
+func _run() -> void:
+	var database := make_database([make_item("sword"), make_item("gem")])
+
+	# A constraint on one side rejects the incoming item.
+	var first := make_grid(database, Vector2i(2, 2))
+	var second := make_grid(database, Vector2i(2, 2))
+	first.add_at_position(Vector2i(0, 0), "sword", 1)
+	second.add_at_position(Vector2i(0, 0), "gem", 3)
+	var reject := RejectItem.new()
+	reject.rejected_id = "sword"
+	second.constraints = [reject]
+	check(not first.swap_stacks(Vector2i(0, 0), second, Vector2i(0, 0)), "swap accepted an item the constraint rejects")
+	check(first.get_stack_at(Vector2i(0, 0)).item_id == "sword", "rejected swap changed the first inventory")
+	check(second.get_stack_at(Vector2i(0, 0)).item_id == "gem", "rejected swap changed the second inventory")
+
+	# Constraints judge the inventory without the outgoing stack, so a
+	# one-stack limit still lets the stacks trade places.
+	second.constraints = [OneStack.new()]
+	check(second.swap_stacks(Vector2i(0, 0), first, Vector2i(0, 0)), "one-stack limit blocked a swap that keeps the stack count")
+	check(first.get_stack_at(Vector2i(0, 0)).item_id == "gem", "swap did not move the gem")
+	check(second.get_stack_at(Vector2i(0, 0)).item_id == "sword", "swap did not move the sword")
+	check(second.stacks.size() == 1, "the swap changed the stack count")
+
+	# Amount changes still report through filled / emptied.
+	var full := make_grid(database, Vector2i(1, 1))
+	var other := make_grid(database, Vector2i(1, 1))
+	full.add_at_position(Vector2i(0, 0), "sword", 1)
+	other.add_at_position(Vector2i(0, 0), "gem", 2)
+	var filled := [0]
+	full.filled.connect(func(): filled[0] += 1)
+	check(full.swap_stacks(Vector2i(0, 0), other, Vector2i(0, 0)), "plain swap failed")
+	check(filled[0] == 1, "swap did not emit filled on a full inventory")
@@ -0,0 +1,45 @@
+extends "inventory_test.gd"
+## The recipe lookups of InventoryDatabase must follow recipes edited after
+## the indexes were first built.
+
+
+func make_station(id: String) -> CraftStationType:
+	var station := CraftStationType.new()
+	station.id = id
+	return station
+
+
+func make_recipe(station: CraftStationType, product_id: String) -> Recipe:
+	var product := ItemStack.new()
+	product.item_id = product_id
+	product.amount = 1
+	var recipe := Recipe.new()
+	recipe.station = station
+	recipe.products = [product]
+	return recipe
+
+
+func _run() -> void:
+	var forge := make_station("forge")
+	var bench := make_station("bench")
+	var database := make_database([make_item("sword"), make_item("plank")])
+	database.stations_type = [forge, bench]
+	var sword_recipe := make_recipe(forge, "sword")
+	database.recipes = [sword_recipe]
+	check(database.get_recipes_for_station("forge") == PackedInt32Array([0]), "initial station lookup is wrong")
+
+	# Editing the recipe through its setters.
+	sword_recipe.station = bench
+	check(database.get_recipes_for_station("forge").is_empty(), "station index kept the old station")
+	check(database.get_recipes_for_station("bench") == PackedInt32Array([0]), "station index missed the new station")
+	var plank := ItemStack.new()
+	plank.item_id = "plank"
+	plank.amount = 4
+	sword_recipe.products = [plank]
+	check(database.get_recipes_producing("sword").is_empty(), "product index kept the old product")
+	check(database.get_recipes_producing("plank") == PackedInt32Array([0]), "product index missed the new product")
+
+	# Appending to the shared array returned by get_recipes().
+	database.get_recipes().append(make_recipe(forge, "sword"))
+	check(database.get_recipes_for_station("forge") == PackedInt32Array([1]), "index missed a recipe appended to get_recipes()")
+	check(database.get_recipes_producing("sword") == PackedInt32Array([1]), "product index missed an appended recipe")
@@ -0,0 +1,29 @@
+extends "inventory_test.gd"
+## Compact stack properties are positional against the definition's dynamic
+## properties, so an edited definition must not read them into other keys.
+
+
+func _run() -> void:
+	var sword := make_item("sword")
+	sword.properties = {"durability": 100, "owner": "", "enchanted": false}
+	sword.dynamic_properties = ["durability", "owner"]
+	var database := make_database([sword])
+
+	var properties := {"durability": 42, "owner": "ana", "note": "extra"}
+	var data := database.serialize_stack_properties("sword", properties)
+	var decoded := database.deserialize_stack_properties("sword", data)
+	check(decoded == properties, "round trip changed the properties: %s" % decoded)
+
+	# Reordering the schema changes its hash; values are not shuffled into
+	# the wrong keys and keyed extras survive.
+	sword.dynamic_properties = ["owner", "durability"]
+	decoded = database.deserialize_stack_properties("sword", data)
+	check(decoded.get("owner") == "", "a reordered schema read a value into 'owner': %s" % decoded)
+	check(decoded.get("durability") == 100, "a reordered schema read a value into 'durability': %s" % decoded)
+	check(decoded.get("note") == "extra", "keyed extras were lost on a schema change")
+
+	# A new default type changes the hash as well.
+	sword.dynamic_properties = ["durability", "owner"]
+	sword.properties = {"durability": 100.0, "owner": "", "enchanted": false}
+	decoded = database.deserialize_stack_properties("sword", data)
+	check(decoded.get("durability") == 100.0, "a retyped schema decoded the old value: %s" % decoded)